@@ -0,0 +1,121 @@
+// Read throughput of ConcurrentTree against a shared_mutex-guarded BinaryTree while one
+// writer keeps inserting.
+// Usage: bench_concurrent [size] [max_threads]   (defaults to 1M keys, hardware threads)
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "../lib/binarytree/binary_tree.h"
+#include "../lib/binarytree/concurrent_tree.h"
+
+namespace {
+    constexpr auto run_time = std::chrono::milliseconds(500);
+
+    // Keeps the lookups observable so they are not optimized away
+    std::atomic<std::uint64_t> hit_sink{0};
+
+    // Baseline: one reader-writer lock around a plain tree
+    struct LockedTree {
+        BinaryTree<int> tree{BalanceMode::AVL};
+        mutable std::shared_mutex mutex;
+
+        void insert_node(const int value) {
+            std::unique_lock lock(mutex);
+            tree.insert_node(value, true);
+        }
+
+        bool search(const int value) const {
+            std::shared_lock lock(mutex);
+            return tree.search(value);
+        }
+    };
+
+    // Run readers and one writer for run_time; returns total reads per second.
+    // make_search() is called on each reader thread and returns that thread's search function.
+    template<typename MakeSearch, typename Insert>
+    double measure(const unsigned readers, const int key_range, MakeSearch make_search, Insert insert) {
+        std::atomic<bool> stop{false};
+        std::atomic<unsigned> ready{0};
+        std::vector<std::uint64_t> reads(readers);
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < readers; ++t) {
+            threads.emplace_back([&, t] {
+                auto search = make_search();
+                std::mt19937 rng(t + 1);
+                std::uniform_int_distribution<int> dist(0, key_range);
+                ready.fetch_add(1);
+                std::uint64_t done = 0, hits = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    for (int i = 0; i < 256; ++i) hits += search(dist(rng));
+                    done += 256;
+                }
+                reads[t] = done;
+                hit_sink.fetch_add(hits, std::memory_order_relaxed);
+            });
+        }
+        threads.emplace_back([&] {
+            std::mt19937 rng(0);
+            std::uniform_int_distribution<int> dist(0, key_range);
+            while (!stop.load(std::memory_order_relaxed)) insert(dist(rng));
+        });
+        while (ready.load() != readers) std::this_thread::yield();
+        std::this_thread::sleep_for(run_time);
+        stop.store(true);
+        for (auto& thread : threads) thread.join();
+
+        std::uint64_t total = 0;
+        for (const auto count : reads) total += count;
+        return static_cast<double>(total) / std::chrono::duration<double>(run_time).count();
+    }
+
+    void run(const std::size_t size, const unsigned max_threads) {
+        const int key_range = static_cast<int>(size) * 2;
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> dist(0, key_range);
+        std::vector<int> values(size);
+        for (auto& value : values) value = dist(rng);
+
+        std::cout << "keys=" << size << " (one writer inserting throughout)" << std::endl
+                  << "  readers     shared_mutex M reads/s    ConcurrentTree M reads/s" << std::endl;
+        for (unsigned readers = 1; readers <= max_threads; readers *= 2) {
+            LockedTree locked;
+            locked.tree.insert_many(values, true);
+            const double locked_rate = measure(readers, key_range,
+                [&] { return [&](const int v) { return locked.search(v); }; },
+                [&](const int v) { locked.insert_node(v); });
+
+            ConcurrentTree<int> concurrent;
+            concurrent.insert_many(values, true);
+            const double concurrent_rate = measure(readers, key_range,
+                [&] {
+                    return [reader = std::make_shared<ConcurrentTree<int>::Reader>(concurrent)](const int v) {
+                        return reader->search(v);
+                    };
+                },
+                [&](const int v) { concurrent.insert_node(v, true); });
+
+            std::cout << std::fixed << std::setprecision(2)
+                      << "  " << std::setw(7) << readers
+                      << "  " << std::setw(24) << locked_rate / 1e6
+                      << "  " << std::setw(26) << concurrent_rate / 1e6 << std::endl;
+        }
+    }
+}
+
+int main(const int argc, char** argv) {
+    const std::size_t size = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    unsigned max_threads = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10))
+                                    : std::thread::hardware_concurrency();
+    if (max_threads == 0) max_threads = 1;
+    run(size, max_threads);
+    return 0;
+}
@@ -0,0 +1,61 @@
+// Pointer-chasing BinaryTree::search versus the Eytzinger FrozenTree snapshot.
+// Usage: bench_frozen [size ...]   (defaults to 1M and 10M keys)
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../lib/binarytree/binary_tree.h"
+#include "../lib/binarytree/frozen_tree.h"
+
+namespace {
+    constexpr std::size_t lookups = 5'000'000;
+
+    // Run every lookup through search and return nanoseconds per lookup
+    template<typename Search>
+    double time_lookups(const std::vector<int>& queries, std::size_t& hits, Search search) {
+        const auto start = std::chrono::steady_clock::now();
+        hits = 0;
+        for (const int query : queries) hits += search(query);
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / static_cast<double>(queries.size());
+    }
+
+    void run(const std::size_t size) {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> dist(0, static_cast<int>(size) * 2);
+
+        // Random insertion order scatters nodes the way an interactive session does
+        BinaryTree<int> tree;
+        for (std::size_t i = 0; i < size; ++i) tree.insert_node(dist(rng), true);
+        const FrozenTree<int> frozen(tree.get_root());
+
+        std::vector<int> queries(lookups);
+        for (auto& query : queries) query = dist(rng);
+
+        std::size_t tree_hits, frozen_hits;
+        const double tree_ns = time_lookups(queries, tree_hits, [&](const int v) { return tree.search(v); });
+        const double frozen_ns = time_lookups(queries, frozen_hits, [&](const int v) { return frozen.search(v); });
+        if (tree_hits != frozen_hits) {
+            std::cerr << "Result mismatch: " << tree_hits << " vs " << frozen_hits << std::endl;
+            std::exit(1);
+        }
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << "keys=" << size << " lookups=" << lookups << " hits=" << tree_hits << std::endl
+                  << "  BinaryTree::search  " << tree_ns << " ns/op" << std::endl
+                  << "  FrozenTree::search  " << frozen_ns << " ns/op"
+                  << "  (x" << tree_ns / frozen_ns << ")" << std::endl;
+    }
+}
+
+int main(const int argc, char** argv) {
+    std::vector<std::size_t> sizes;
+    for (int i = 1; i < argc; ++i) sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+    if (sizes.empty()) sizes = {1'000'000, 10'000'000};
+    for (const std::size_t size : sizes) run(size);
+    return 0;
+}
@@ -0,0 +1,404 @@
+// BinaryTree microbenchmark suite: insert_node, insert_many, search, count_entries, get_path
+// and the three traversals over several key distributions, value types and sizes.
+// Inputs come from fixed seeds, so runs on one machine are comparable between releases.
+// Usage: bench [--types int,double,string,char] [--dists uniform,sorted,reverse,zipf,duplicates]
+//              [--sizes 1000,10000,...] [--ops insert_node,search,...] [--balance avl|none]
+//              [--duplicates chain|counted] [--min-time seconds] [--seed n]
+//              [--format table|csv|json] [--out file]
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../lib/binarytree/binary_tree.h"
+
+namespace {
+    // Keeps benchmarked results observable so they are not optimized away
+    std::atomic<std::uint64_t> sink{0};
+
+    // Unbalanced trees degenerate into lists on sorted input; larger sizes would take hours
+    constexpr std::size_t unbalanced_sorted_limit = 20'000;
+
+    struct Options {
+        std::vector<std::string> types{"int", "double", "string", "char"};
+        std::vector<std::string> dists{"uniform", "sorted", "reverse", "zipf", "duplicates"};
+        std::vector<std::size_t> sizes{1'000, 10'000, 100'000, 1'000'000, 10'000'000};
+        std::vector<std::string> ops{"insert_node", "insert_many", "search", "count_entries", "get_path",
+                                     "inorder", "preorder", "postorder"};
+        BalanceMode balance = BalanceMode::AVL;
+        DuplicateMode duplicates = DuplicateMode::Chain;
+        double min_time = 0.25;
+        std::uint64_t seed = 42;
+        std::string format = "table";
+        std::string out;
+    };
+
+    struct Result {
+        std::string type;
+        std::string dist;
+        std::size_t size;
+        std::string op;
+        std::uint64_t ops;
+        double seconds;
+    };
+
+    // Operations timed and the seconds they took
+    struct Sample {
+        std::uint64_t ops = 0;
+        double seconds = 0;
+    };
+
+    std::vector<std::string> split(const std::string& list) {
+        std::vector<std::string> items;
+        std::stringstream stream(list);
+        for (std::string item; std::getline(stream, item, ',');) {
+            if (!item.empty()) items.push_back(item);
+        }
+        return items;
+    }
+
+    double elapsed_since(const std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Call body(k) with k doubling until the timed total reaches min_time; body returns
+    // the time spent on its k repetitions, so setup outside the timed part is not counted
+    template<typename Body>
+    Sample repeat_until(const double min_time, Body body) {
+        Sample total;
+        std::uint64_t k = 1;
+        while (total.seconds < min_time) {
+            const Sample sample = body(k);
+            total.ops += sample.ops;
+            total.seconds += sample.seconds;
+            if (sample.seconds < min_time / 8) k *= 2;
+        }
+        return total;
+    }
+
+    // Key ids from the distribution; every id is below universe
+    std::vector<std::uint64_t> generate_ids(const std::string& dist, const std::size_t n, const std::uint64_t universe,
+                                            const std::uint64_t seed) {
+        std::vector<std::uint64_t> ids(n);
+        std::mt19937_64 rng(seed);
+        if (dist == "uniform") {
+            std::uniform_int_distribution<std::uint64_t> pick(0, universe - 1);
+            for (auto& id : ids) id = pick(rng);
+        } else if (dist == "sorted") {
+            for (std::size_t i = 0; i < n; ++i) ids[i] = i * universe / n;
+        } else if (dist == "reverse") {
+            for (std::size_t i = 0; i < n; ++i) ids[i] = (n - 1 - i) * universe / n;
+        } else if (dist == "zipf") {
+            // Gray et al. "Quickly generating billion-record synthetic databases", theta 0.99 as in YCSB
+            constexpr double theta = 0.99;
+            double zeta_n = 0;
+            for (std::uint64_t i = 1; i <= universe; ++i) zeta_n += 1.0 / std::pow(static_cast<double>(i), theta);
+            const double zeta_2 = 1.0 + 1.0 / std::pow(2.0, theta);
+            const double alpha = 1.0 / (1.0 - theta);
+            const double eta = (1.0 - std::pow(2.0 / static_cast<double>(universe), 1.0 - theta)) / (1.0 - zeta_2 / zeta_n);
+            std::uniform_real_distribution<double> unit(0.0, 1.0);
+            for (auto& id : ids) {
+                const double u = unit(rng);
+                const double uz = u * zeta_n;
+                std::uint64_t rank;
+                if (uz < 1.0) rank = 0;
+                else if (uz < 1.0 + std::pow(0.5, theta)) rank = 1;
+                else rank = static_cast<std::uint64_t>(static_cast<double>(universe) * std::pow(eta * u - eta + 1.0, alpha));
+                // Spread the hot ranks over the key space instead of the left edge of the tree
+                std::uint64_t x = std::min(rank, universe - 1) + 0x9e3779b97f4a7c15ULL;
+                x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+                id = (x ^ (x >> 31)) % universe;
+            }
+        } else if (dist == "duplicates") {
+            // About a hundred copies of each key
+            std::uniform_int_distribution<std::uint64_t> pick(0, std::max<std::uint64_t>(universe / 200, 1) - 1);
+            for (auto& id : ids) id = pick(rng);
+        } else {
+            throw std::runtime_error("Unknown distribution '" + dist + "'");
+        }
+        return ids;
+    }
+
+    // Order-preserving map from key id to value, so sorted ids give sorted values
+    template<typename T>
+    T make_value(const std::uint64_t id, const std::uint64_t universe) {
+        if constexpr (std::is_same_v<T, std::string>) {
+            // Fixed width keeps lexicographic order equal to numeric order
+            std::string value(12, '0');
+            char digits[20];
+            const auto end = std::to_chars(digits, digits + sizeof(digits), id).ptr;
+            std::copy(digits, end, value.end() - (end - digits));
+            return value;
+        } else if constexpr (std::is_same_v<T, char>) {
+            return static_cast<char>('!' + id * 94 / universe);
+        } else if constexpr (std::is_floating_point_v<T>) {
+            return static_cast<T>(id) + 0.5;
+        } else {
+            return static_cast<T>(id);
+        }
+    }
+
+    template<typename T>
+    std::uint64_t fold(const T& value) {
+        if constexpr (std::is_same_v<T, std::string>) return value.size() + static_cast<unsigned char>(value.back());
+        else return static_cast<std::uint64_t>(value);
+    }
+
+    template<typename T>
+    void run_case(const Options& options, const std::string& type, const std::string& dist, const std::size_t n,
+                  std::vector<Result>& results, const std::function<void(const Result&)>& emit) {
+        const std::uint64_t universe = std::max<std::uint64_t>(2 * n, 2);
+        const auto ids = generate_ids(dist, n, universe, options.seed);
+        std::vector<T> values;
+        values.reserve(n);
+        for (const auto id : ids) values.push_back(make_value<T>(id, universe));
+
+        // Lookups follow the same distribution, except sorted inputs which get uniform probes
+        const std::size_t query_count = std::min<std::size_t>(n, 1 << 16);
+        const std::string query_dist = dist == "sorted" || dist == "reverse" ? "uniform" : dist;
+        std::vector<T> queries;
+        queries.reserve(query_count);
+        for (const auto id : generate_ids(query_dist, query_count, universe, options.seed + 1)) {
+            queries.push_back(make_value<T>(id, universe));
+        }
+        // count_entries and get_path probe stored values; get_path throws on a miss
+        std::vector<T> hits;
+        hits.reserve(query_count);
+        std::mt19937_64 rng(options.seed + 2);
+        std::uniform_int_distribution<std::size_t> position(0, n - 1);
+        for (std::size_t i = 0; i < query_count; ++i) hits.push_back(values[position(rng)]);
+
+        const auto wanted = [&options](const std::string& op) {
+            return std::find(options.ops.begin(), options.ops.end(), op) != options.ops.end();
+        };
+        const auto record = [&](const std::string& op, const Sample& sample) {
+            results.push_back({type, dist, n, op, sample.ops, sample.seconds});
+            emit(results.back());
+        };
+        const auto build = [&] {
+            BinaryTree<T> tree(options.balance, options.duplicates);
+            for (const T& value : values) tree.insert_node(value, true);
+            return tree;
+        };
+
+        BinaryTree<T> tree(options.balance, options.duplicates);
+        if (wanted("insert_node")) {
+            record("insert_node", repeat_until(options.min_time, [&](const std::uint64_t k) {
+                Sample sample;
+                for (std::uint64_t r = 0; r < k; ++r) {
+                    BinaryTree<T> fresh(options.balance, options.duplicates);
+                    const auto start = std::chrono::steady_clock::now();
+                    for (const T& value : values) fresh.insert_node(value, true);
+                    sample.seconds += elapsed_since(start);
+                    sample.ops += n;
+                    tree = std::move(fresh);
+                }
+                return sample;
+            }));
+        } else {
+            tree = build();
+        }
+
+        if (wanted("insert_many")) {
+            record("insert_many", repeat_until(options.min_time, [&](const std::uint64_t k) {
+                Sample sample;
+                for (std::uint64_t r = 0; r < k; ++r) {
+                    BinaryTree<T> fresh(options.balance, options.duplicates);
+                    std::vector<T> batch = values;
+                    const auto start = std::chrono::steady_clock::now();
+                    fresh.insert_many(std::move(batch), true);
+                    sample.seconds += elapsed_since(start);
+                    sample.ops += n;
+                }
+                return sample;
+            }));
+        }
+
+        // Cycles through probes, k of them per repetition
+        const auto probe = [&](const std::string& op, const std::vector<T>& probes, auto&& call) {
+            std::size_t next = 0;
+            record(op, repeat_until(options.min_time, [&](const std::uint64_t k) {
+                std::uint64_t folded = 0;
+                const auto start = std::chrono::steady_clock::now();
+                for (std::uint64_t r = 0; r < k; ++r) {
+                    folded += call(probes[next]);
+                    if (++next == probes.size()) next = 0;
+                }
+                const Sample sample{k, elapsed_since(start)};
+                sink.fetch_add(folded, std::memory_order_relaxed);
+                return sample;
+            }));
+        };
+
+        // Text output goes to a stream without a buffer: formatting is skipped, the walk is not
+        std::ostream discard(nullptr);
+        if (wanted("search")) probe("search", queries, [&](const T& value) { return tree.search(value) ? 1 : 0; });
+        if (wanted("count_entries")) {
+            probe("count_entries", hits, [&](const T& value) { return tree.count_entries(value, discard); });
+        }
+        if (wanted("get_path")) {
+            probe("get_path", hits, [&](const T& value) { tree.get_path(value, discard); return 1; });
+        }
+
+        const auto traverse = [&](const std::string& op, auto&& range) {
+            record(op, repeat_until(options.min_time, [&](const std::uint64_t k) {
+                std::uint64_t folded = 0;
+                const auto start = std::chrono::steady_clock::now();
+                for (std::uint64_t r = 0; r < k; ++r) {
+                    for (const T& value : range()) folded += fold(value);
+                }
+                const Sample sample{k * n, elapsed_since(start)};
+                sink.fetch_add(folded, std::memory_order_relaxed);
+                return sample;
+            }));
+        };
+        if (wanted("inorder")) traverse("inorder", [&] { return tree.inorder_range(); });
+        if (wanted("preorder")) traverse("preorder", [&] { return tree.preorder_range(); });
+        if (wanted("postorder")) traverse("postorder", [&] { return tree.postorder_range(); });
+    }
+
+    const char* balance_name(const BalanceMode mode) { return mode == BalanceMode::AVL ? "avl" : "none"; }
+    const char* duplicates_name(const DuplicateMode mode) { return mode == DuplicateMode::Counted ? "counted" : "chain"; }
+
+    double ns_per_op(const Result& result) { return result.seconds * 1e9 / static_cast<double>(result.ops); }
+    double ops_per_sec(const Result& result) { return static_cast<double>(result.ops) / result.seconds; }
+
+    void write_table_row(std::ostream& out, const Result& result) {
+        out << std::left << std::setw(8) << result.type << std::setw(12) << result.dist << std::right
+            << std::setw(10) << result.size << "  " << std::left << std::setw(15) << result.op << std::right
+            << std::fixed << std::setprecision(1) << std::setw(12) << ns_per_op(result)
+            << std::setprecision(0) << std::setw(16) << ops_per_sec(result) << std::endl;
+    }
+
+    void write_csv_row(std::ostream& out, const Options& options, const Result& result) {
+        out << result.type << ',' << result.dist << ',' << result.size << ',' << result.op << ','
+            << balance_name(options.balance) << ',' << duplicates_name(options.duplicates) << ','
+            << result.ops << ',' << std::setprecision(9) << result.seconds << ','
+            << std::fixed << std::setprecision(3) << ns_per_op(result) << ','
+            << std::setprecision(1) << ops_per_sec(result) << std::defaultfloat << std::endl;
+    }
+
+    void write_json(std::ostream& out, const Options& options, const std::vector<Result>& results) {
+        out << "{\n  \"suite\": \"binary_tree\",\n"
+            << "  \"balance\": \"" << balance_name(options.balance) << "\",\n"
+            << "  \"duplicates\": \"" << duplicates_name(options.duplicates) << "\",\n"
+            << "  \"seed\": " << options.seed << ",\n"
+            << "  \"min_time\": " << options.min_time << ",\n"
+            << "  \"results\": [";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const Result& result = results[i];
+            out << (i ? ",\n" : "\n") << "    {\"type\": \"" << result.type << "\", \"distribution\": \"" << result.dist
+                << "\", \"size\": " << result.size << ", \"operation\": \"" << result.op
+                << "\", \"ops\": " << result.ops << ", \"seconds\": " << std::setprecision(9) << result.seconds
+                << ", \"ns_per_op\": " << std::fixed << std::setprecision(3) << ns_per_op(result)
+                << ", \"ops_per_sec\": " << std::setprecision(1) << ops_per_sec(result) << std::defaultfloat << "}";
+        }
+        out << "\n  ]\n}" << std::endl;
+    }
+
+    Options parse_options(const int argc, char** argv) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (i + 1 >= argc) throw std::runtime_error("Missing value for '" + arg + "'");
+            const std::string value = argv[++i];
+            if (arg == "--types") {
+                options.types = split(value);
+            } else if (arg == "--dists") {
+                options.dists = split(value);
+            } else if (arg == "--sizes") {
+                options.sizes.clear();
+                for (const auto& size : split(value)) options.sizes.push_back(std::stoull(size));
+            } else if (arg == "--ops") {
+                options.ops = split(value);
+            } else if (arg == "--balance" && (value == "avl" || value == "none")) {
+                options.balance = value == "avl" ? BalanceMode::AVL : BalanceMode::None;
+            } else if (arg == "--duplicates" && (value == "chain" || value == "counted")) {
+                options.duplicates = value == "counted" ? DuplicateMode::Counted : DuplicateMode::Chain;
+            } else if (arg == "--min-time") {
+                options.min_time = std::stod(value);
+            } else if (arg == "--seed") {
+                options.seed = std::stoull(value);
+            } else if (arg == "--format" && (value == "table" || value == "csv" || value == "json")) {
+                options.format = value;
+            } else if (arg == "--out") {
+                options.out = value;
+            } else {
+                throw std::runtime_error("Invalid option '" + arg + " " + value + "'");
+            }
+        }
+        return options;
+    }
+}
+
+int main(const int argc, char** argv) {
+    Options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    std::ofstream file;
+    if (!options.out.empty()) {
+        file.open(options.out);
+        if (!file) {
+            std::cerr << "Cannot open '" << options.out << "' for writing" << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = options.out.empty() ? std::cout : file;
+
+    // Table and CSV rows are written as soon as they are measured; JSON at the end
+    std::function<void(const Result&)> emit = [](const Result&) {};
+    if (options.format == "table") {
+        out << "type    dist              size  operation             ns/op           ops/s" << std::endl;
+        emit = [&out](const Result& result) { write_table_row(out, result); };
+    } else if (options.format == "csv") {
+        out << "type,distribution,size,operation,balance,duplicates,ops,seconds,ns_per_op,ops_per_sec" << std::endl;
+        emit = [&out, &options](const Result& result) { write_csv_row(out, options, result); };
+    }
+
+    std::vector<Result> results;
+    try {
+        for (const auto& type : options.types) {
+            for (const auto& dist : options.dists) {
+                for (const auto size : options.sizes) {
+                    if (size == 0) continue;
+                    if (options.balance == BalanceMode::None && (dist == "sorted" || dist == "reverse") &&
+                        size > unbalanced_sorted_limit) {
+                        std::cerr << "Skipping " << type << " " << dist << " " << size
+                                  << ": an unbalanced tree degenerates into a list" << std::endl;
+                        continue;
+                    }
+                    if (type == "int") run_case<int>(options, type, dist, size, results, emit);
+                    else if (type == "double") run_case<double>(options, type, dist, size, results, emit);
+                    else if (type == "string") run_case<std::string>(options, type, dist, size, results, emit);
+                    else if (type == "char") run_case<char>(options, type, dist, size, results, emit);
+                    else throw std::runtime_error("Unknown type '" + type + "'");
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    if (options.format == "json") write_json(out, options, results);
+    return 0;
+}
@@ -0,0 +1,72 @@
+// Insert throughput with no log, an fsync per insert, and group commit at several group sizes.
+// Usage: bench_wal [inserts] [dir]   (defaults to 200K inserts, the current directory)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../lib/binarytree/binary_tree.h"
+#include "../lib/binarytree/write_ahead_log.h"
+
+namespace {
+    // fsync per insert is bounded by the disk, not the tree; a short run is enough
+    constexpr std::size_t every_op_limit = 5000;
+
+    // Inserts per second into a fresh AVL tree; log is null for the unlogged baseline
+    double measure(const std::vector<int>& values, const std::size_t count, WriteAheadLog<int>* log) {
+        BinaryTree<int> tree(BalanceMode::AVL);
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < count; ++i) {
+            if (log) log->log_insert(values[i], true);
+            tree.insert_node(values[i], true);
+        }
+        if (log) log->commit();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return static_cast<double>(count) / elapsed.count();
+    }
+
+    double measure_logged(const std::vector<int>& values, const std::size_t count, const std::string& path,
+                          const SyncPolicy policy, const std::size_t group_size) {
+        std::remove(path.c_str());
+        double rate;
+        {
+            WriteAheadLog<int> log(path, policy, group_size);
+            log.reset(1);
+            rate = measure(values, count, &log);
+        }
+        std::remove(path.c_str());
+        return rate;
+    }
+
+    void report(const std::string& name, const std::size_t count, const double rate) {
+        std::cout << "  " << std::left << std::setw(20) << name << std::right
+                  << std::setw(10) << count
+                  << std::fixed << std::setprecision(0) << std::setw(16) << rate << std::endl;
+    }
+}
+
+int main(const int argc, char** argv) {
+    const std::size_t size = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200'000;
+    const std::string dir = argc > 2 ? argv[2] : ".";
+    const std::string path = dir + "/bench_wal.wal";
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> dist(0, static_cast<int>(size) * 2);
+    std::vector<int> values(size);
+    for (auto& value : values) value = dist(rng);
+
+    std::cout << "  mode                   inserts       inserts/s" << std::endl;
+    report("no log", size, measure(values, size, nullptr));
+    const std::size_t every_op = std::min(size, every_op_limit);
+    report("fsync per insert", every_op, measure_logged(values, every_op, path, SyncPolicy::EveryOp, 1));
+    for (const std::size_t group : {64, 256, 1024}) {
+        report("group of " + std::to_string(group), size, measure_logged(values, size, path, SyncPolicy::Group, group));
+    }
+    return 0;
+}
@@ -4,24 +4,82 @@
 
 #ifndef BINARY_TREE_H
 #define BINARY_TREE_H
+#include <cstddef>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <ranges>
 #include <vector>
 #include <stdexcept>
 #include <climits>
+#include <cstdlib>
+#include <string>
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <type_traits>
+#include <utility>
+#include "node_pool.h"
+#include "thread_pool.h"
+#include "tree_counters.h"
+#include "lookup_key.h"
 
-// Template class for node of a Binary tree
-template<typename T>
+// Balancing strategy applied to a tree on insertion
+enum class BalanceMode {
+    None,   // Plain binary search tree
+    AVL     // Height-balanced AVL tree (height stays O(log n))
+};
+
+// How repeated insertions of an equal value are stored
+enum class DuplicateMode {
+    Chain,   // Every copy is a separate node placed to the left
+    Counted  // One node per distinct value holding its multiplicity
+};
+
+// Stands in for the mapped value of set trees; [[no_unique_address]] keeps it free
+struct NoMappedValue {};
+
+// How BinaryTree::combine counts the copies of a value held a times by one tree and b times by the other
+enum class SetOperation {
+    Merge,         // a + b: every copy from both
+    Union,         // max(a, b)
+    Intersection,  // min(a, b)
+    Difference     // a - b (none when b holds at least as many)
+};
+
+// Template class for node of a Binary tree; V is the mapped type of map trees
+template<typename T, typename V = void>
 class Node {
 public:
-    // Data held by the node
+    using mapped_type = std::conditional_t<std::is_void_v<V>, NoMappedValue, V>;
+
+    // Data held by the node (the key of map trees)
     T data;
+    // Value associated with data in map trees
+    [[no_unique_address]] mapped_type value;
     // Pointer to the left child
     Node* left;
     // Pointer to the right child
     Node* right;
+    // Height of the subtree rooted at this node (leaf has height 0)
+    int height;
+    // Number of copies of data stored in this node (always 1 in chain mode)
+    int count;
+    // Number of values stored in the subtree rooted at this node, copies included
+    int size;
 
-    // Constructor to initialize node with a value
-    explicit Node (T value) : data(value), left(nullptr), right(nullptr) {}
+    // Constructor to initialize node with a value built in place from args
+    template<typename... Args>
+        requires std::constructible_from<T, Args...>
+    explicit Node(Args&&... args)
+        : data(std::forward<Args>(args)...), value(), left(nullptr), right(nullptr), height(0), count(1), size(1) {}
+    // Constructor for map nodes holding key and its value
+    template<typename KeyArg, typename ValueArg>
+        requires (!std::is_void_v<V>)
+    Node(std::piecewise_construct_t, KeyArg&& key, ValueArg&& mapped)
+        : data(std::forward<KeyArg>(key)), value(std::forward<ValueArg>(mapped)),
+          left(nullptr), right(nullptr), height(0), count(1), size(1) {}
     // Destructor
     ~Node() = default;
 
@@ -32,200 +90,1200 @@ public:
     Node& operator=(Node&&) = delete;
 };
 
-template<typename T>
+// Order in which TreeIterator visits nodes
+enum class TraversalOrder {
+    Inorder,
+    Preorder,
+    Postorder
+};
+
+// Forward iterator over the values of a tree, driven by an explicit stack.
+// A node holding several copies (counted mode) yields its value count times; map trees yield keys.
+template<typename T, TraversalOrder Order, typename V = void>
+class TreeIterator {
+public:
+    using iterator_concept = std::forward_iterator_tag;
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    // End iterator
+    TreeIterator() = default;
+    explicit TreeIterator(const Node<T, V>* root) {
+        if constexpr (Order == TraversalOrder::Inorder) {
+            descend_left(root);
+            pop_next();
+        } else if constexpr (Order == TraversalOrder::Preorder) {
+            current = root;
+        } else {
+            descend_to_first_postorder(root);
+            current = stack.empty() ? nullptr : stack.back();
+        }
+    }
+
+    reference operator*() const { return current->data; }
+    pointer operator->() const { return &current->data; }
+    // Node the iterator currently points at
+    [[nodiscard]] const Node<T, V>* node() const { return current; }
+
+    TreeIterator& operator++() {
+        if (++copy < current->count) return *this;
+        copy = 0;
+        advance();
+        return *this;
+    }
+
+    TreeIterator operator++(int) {
+        TreeIterator previous = *this;
+        ++*this;
+        return previous;
+    }
+
+    bool operator==(const TreeIterator& other) const {
+        return current == other.current && copy == other.copy;
+    }
+
+private:
+    const Node<T, V>* current = nullptr;
+    int copy = 0;                          // Copy of current->data being yielded
+    std::vector<const Node<T, V>*> stack;     // Pending nodes (ancestors for inorder/postorder)
+
+    void descend_left(const Node<T, V>* node) {
+        while (node != nullptr) {
+            stack.push_back(node);
+            node = node->left;
+        }
+    }
+
+    // Push the path to the first node a postorder walk of this subtree emits
+    void descend_to_first_postorder(const Node<T, V>* node) {
+        while (node != nullptr) {
+            stack.push_back(node);
+            node = node->left ? node->left : node->right;
+        }
+    }
+
+    void pop_next() {
+        if (stack.empty()) {
+            current = nullptr;
+            return;
+        }
+        current = stack.back();
+        stack.pop_back();
+    }
+
+    void advance() {
+        if constexpr (Order == TraversalOrder::Inorder) {
+            descend_left(current->right);
+            pop_next();
+        } else if constexpr (Order == TraversalOrder::Preorder) {
+            if (current->right) stack.push_back(current->right);
+            if (current->left) stack.push_back(current->left);
+            pop_next();
+        } else {
+            // The stack holds the path to current; its parent is next unless a right sibling waits
+            const Node<T, V>* done = current;
+            stack.pop_back();
+            if (stack.empty()) {
+                current = nullptr;
+                return;
+            }
+            const Node<T, V>* parent = stack.back();
+            if (parent->left == done && parent->right != nullptr) descend_to_first_postorder(parent->right);
+            current = stack.back();
+        }
+    }
+};
+
+// Lightweight view over a subtree, usable with range-for and std::ranges algorithms
+template<typename T, TraversalOrder Order, typename V = void>
+class TraversalRange {
+public:
+    using iterator = TreeIterator<T, Order, V>;
+
+    explicit TraversalRange(const Node<T, V>* subtree_root) : root(subtree_root) {}
+    iterator begin() const { return iterator(root); }
+    iterator end() const { return iterator(); }
+
+private:
+    const Node<T, V>* root;
+};
+
+static_assert(std::forward_iterator<TreeIterator<int, TraversalOrder::Inorder>>);
+static_assert(std::ranges::forward_range<TraversalRange<int, TraversalOrder::Postorder>>);
+
+// Occurrences of a value and the levels they were found on (INT_MAX/-1 when absent)
+struct EntryStats {
+    int count = 0;
+    int min_level = INT_MAX;
+    int max_level = -1;
+};
+
+// BinaryTree<T> is an ordered multiset of T. With a mapped type V every node also holds a
+// value, looked up and updated by key with get/put/upsert. Keys are ordered by Compare and
+// two keys are equal when neither is less than the other, so T needs no operator==.
+// Allocator is instantiated with Node<T, V> and must provide create(args...), destroy(node),
+// release() and a releases_in_bulk flag (see node_pool.h)
+template<typename T, typename V = void, typename Compare = std::less<>, template<typename> class Allocator = NodePool>
 class BinaryTree {
+public:
+    using NodeType = Node<T, V>;
+    using mapped_type = typename NodeType::mapped_type;
+    // Argument type of lookups: std::string_view for string trees (see lookup_key.h) when
+    // Compare is transparent, since a plain comparator only accepts T
+    using Key = std::conditional_t<requires { typename Compare::is_transparent; }, lookup_key_t<T>, const T&>;
+
 private:
     // Pointer to the root of the tree
-    Node<T>* root;
+    NodeType* root;
+    // Balancing strategy chosen at construction
+    BalanceMode balance;
+    // Duplicate storage policy chosen at construction
+    DuplicateMode duplicates;
+    // Scratch buffer of links visited by the last insertion (reused between inserts)
+    std::vector<NodeType**> insert_path;
+    // Scratch buffers of split and join (reused between erase_all calls)
+    std::vector<std::pair<NodeType*, bool>> split_path;
+    std::vector<NodeType**> join_path;
+    // Source of all nodes owned by the tree
+    Allocator<NodeType> allocator;
+    // Key ordering
+    [[no_unique_address]] Compare compare;
+    // Nodes holding the smallest and largest value, kept current on every insertion
+    const NodeType* min_node = nullptr;
+    const NodeType* max_node = nullptr;
 
-    // Method to properly clear the tree if destructor was called
-    void clear_recursive(Node<T>* node) {
-        if (node) {
-            clear_recursive(node->left);
-            clear_recursive(node->right);
-            delete node;
-        }
+    // Re-derive min_node/max_node by walking both spines, O(height)
+    void refresh_extremes() {
+        min_node = max_node = root;
+        while (min_node && min_node->left) min_node = min_node->left;
+        while (max_node && max_node->right) max_node = max_node->right;
     }
 
-    // Recursive method to search for a value in the tree
-    bool search_recursive(Node<T>* current, T value) {
-        if (current == nullptr) return false;
-        if (current->data == value) return true;
+    // Height of a possibly empty subtree
+    static int node_height(const NodeType* node) {
+        return node ? node->height : -1;
+    }
+
+    // Number of values in a possibly empty subtree
+    static int node_size(const NodeType* node) {
+        return node ? node->size : 0;
+    }
+
+    // Recalculate node height and subtree size from its children
+    static void update_node(NodeType* node) {
+        node->height = 1 + std::max(node_height(node->left), node_height(node->right));
+        node->size = node->count + node_size(node->left) + node_size(node->right);
+    }
+
+    static NodeType* rotate_right(NodeType* node) {
+        NodeType* pivot = node->left;
+        node->left = pivot->right;
+        pivot->right = node;
+        update_node(node);
+        update_node(pivot);
+        return pivot;
+    }
 
-        if (value < current->data) return search_recursive(current->left, value);
-        return search_recursive(current->right, value);
+    static NodeType* rotate_left(NodeType* node) {
+        NodeType* pivot = node->right;
+        node->right = pivot->left;
+        pivot->left = node;
+        update_node(node);
+        update_node(pivot);
+        return pivot;
     }
 
-    // Method for Recursive inorder traversal of the tree
-    void inorder_recursive(Node<T>* node) {
-        if (node != nullptr) {
-            inorder_recursive(node->left);
-            std::cout << node->data << " ";
-            inorder_recursive(node->right);
+    // Update node height and size after insertion and restore AVL balance if required.
+    // Rotations keep inorder order, so duplicates may end up on either side of an equal key.
+    NodeType* rebalance(NodeType* node) {
+        update_node(node);
+        if (balance != BalanceMode::AVL) return node;
+
+        const int factor = node_height(node->left) - node_height(node->right);
+        if (factor > 1) {
+            if (node_height(node->left->left) < node_height(node->left->right)) {
+                node->left = rotate_left(node->left);
+            }
+            return rotate_right(node);
+        }
+        if (factor < -1) {
+            if (node_height(node->right->right) < node_height(node->right->left)) {
+                node->right = rotate_right(node->right);
+            }
+            return rotate_left(node);
         }
+        return node;
     }
 
-    // Method for Recursive preorder traversal of the tree
-    void preorderRecursive(Node<T>* node) {
-        if (node != nullptr) {
-            std::cout << node->data << " ";
-            preorderRecursive(node->left);
-            preorderRecursive(node->right);
+    // Visit every node once, handing it to dispose after its children have been detached.
+    // Rotates left children up into the right spine, so no stack is required.
+    template<typename Dispose>
+    static void clear_nodes(NodeType* node, Dispose dispose) {
+        while (node != nullptr) {
+            if (node->left != nullptr) {
+                NodeType* left = node->left;
+                node->left = left->right;
+                left->right = node;
+                node = left;
+            } else {
+                NodeType* right = node->right;
+                dispose(node);
+                node = right;
+            }
         }
     }
 
-    // Helper method to count entries and find min/max levels
-    void count_entries_helper(Node<T>* r, int& counter, const T& value, int currentLevel, int& minLevel, int& maxLevel) const {
-        if (r == nullptr) return;
+    // Keys are equal when neither orders before the other
+    template<typename A, typename B>
+    bool equivalent(const A& a, const B& b) const { return !compare(a, b) && !compare(b, a); }
 
-        // Update current level
-        if (value == r->data) {
-            ++counter;
-            if (currentLevel < minLevel) minLevel = currentLevel;
-            if (currentLevel > maxLevel) maxLevel = currentLevel;
-        }
+    // Subtrees smaller than this are scanned by a single task; forking them costs more than it saves
+    static constexpr int parallel_cutoff = 1 << 14;
 
-        // Recursively search in left and right subtrees
-        count_entries_helper(r->left, counter, value, currentLevel + 1, minLevel, maxLevel);
-        count_entries_helper(r->right, counter, value, currentLevel + 1, minLevel, maxLevel);
+    // Copies of a value form one contiguous run in inorder, but AVL rotations can leave them
+    // on both sides of an equal key. A subtree can only hold value if its side of the node
+    // allows it, so the searches below descend like a lookup and only branch on equal keys:
+    // O(height + matches) instead of a full scan. The node holds value when both sides do.
+    struct Sides { bool left, right; };
+    Sides sides_for(const NodeType* node, Key value) const {
+        return {!compare(node->data, value), !compare(value, node->data)};
     }
 
-    void print_tree_helper(Node<T>* r, const int level) const {
+    // Helper method to count entries and find min/max levels; r sits at the given level
+    void count_entries_helper(const NodeType* r, Key value, EntryStats& stats, const int level = 0) const {
         if (r == nullptr) return;
+        std::vector<std::pair<const NodeType*, int>> stack{{r, level}};
+        std::uint64_t visits = 0;
+        while (!stack.empty()) {
+            const auto [node, currentLevel] = stack.back();
+            stack.pop_back();
+            ++visits;
+
+            // Update current level
+            const Sides sides = sides_for(node, value);
+            if (sides.left && sides.right) {
+                ++stats.count;
+                if (currentLevel < stats.min_level) stats.min_level = currentLevel;
+                if (currentLevel > stats.max_level) stats.max_level = currentLevel;
+            }
 
-        print_tree_helper(r->right, level + 1);
-        for (int i = 0; i < level; i++) {
-            std::cout << "   ";
+            if (node->right && sides.right) stack.emplace_back(node->right, currentLevel + 1);
+            if (node->left && sides.left) stack.emplace_back(node->left, currentLevel + 1);
         }
+        tree_counters::count_visits(visits);
+    }
 
-        std::cout << r->data << std::endl;
-        print_tree_helper(r->left, level + 1);
+    // count_entries_helper split over a pool: the calling thread walks nodes whose subtree
+    // is at least parallel_cutoff and forks each smaller subtree as one task. Count and
+    // min/max level combine in any order, so the result equals the serial search. Only
+    // long runs of one value (heavy duplicates) leave enough work to be worth forking.
+    void count_entries_parallel(const NodeType* r, Key value, EntryStats& stats, WorkStealingPool& pool) const {
+        if (r == nullptr) return;
+        std::deque<EntryStats> partial;
+        TaskGroup group(pool);
+        std::vector<std::pair<const NodeType*, int>> stack{{r, 0}};
+        std::uint64_t visits = 0;
+        while (!stack.empty()) {
+            const auto [node, currentLevel] = stack.back();
+            stack.pop_back();
+            if (node_size(node) < parallel_cutoff) {
+                EntryStats& slot = partial.emplace_back();
+                group.run([this, node, currentLevel, &value, &slot] { count_entries_helper(node, value, slot, currentLevel); });
+                continue;
+            }
+            ++visits;
+            const Sides sides = sides_for(node, value);
+            if (sides.left && sides.right) {
+                ++stats.count;
+                stats.min_level = std::min(stats.min_level, currentLevel);
+                stats.max_level = std::max(stats.max_level, currentLevel);
+            }
+            if (node->right && sides.right) stack.emplace_back(node->right, currentLevel + 1);
+            if (node->left && sides.left) stack.emplace_back(node->left, currentLevel + 1);
+        }
+        group.wait();
+        tree_counters::count_visits(visits);
+        for (const EntryStats& part : partial) {
+            stats.count += part.count;
+            stats.min_level = std::min(stats.min_level, part.min_level);
+            stats.max_level = std::max(stats.max_level, part.max_level);
+        }
     }
 
-    // Modified to track levels of found elements
-    bool find_path(Node<T>* r, T target, std::vector<T>& current_path, int& minLevel, int& maxLevel) const {
+    // Preorder search of the subtree at r for nodes equal to value, calling visitor with the
+    // root-to-node path; prefix holds the values above r
+    template<typename Visitor>
+    bool collect_paths(const NodeType* r, Key value, std::vector<T> prefix, Visitor&& visitor) const {
         if (r == nullptr) return false;
+        const std::size_t base = prefix.size();
+        std::vector<T>& current_path = prefix;
+        bool found_any = false;
+        std::vector<std::pair<const NodeType*, std::size_t>> stack{{r, base}};
+        std::uint64_t visits = 0;
+        while (!stack.empty()) {
+            const auto [node, depth] = stack.back();
+            stack.pop_back();
+            ++visits;
+            current_path.resize(depth);
+            current_path.push_back(node->data);
+
+            const Sides sides = sides_for(node, value);
+            if (sides.left && sides.right) {
+                visitor(std::as_const(current_path));
+                found_any = true;
+            }
+
+            if (node->right && sides.right) stack.emplace_back(node->right, depth + 1);
+            if (node->left && sides.left) stack.emplace_back(node->left, depth + 1);
+        }
+        tree_counters::count_visits(visits);
+        return found_any;
+    }
 
+    // collect_paths split over a pool like count_entries_parallel. Every match on the
+    // calling thread and every forked subtree gets a segment in preorder position, and the
+    // segments are replayed in that order so the visitor sees the serial sequence.
+    template<typename Visitor>
+    bool collect_paths_parallel(const NodeType* r, Key value, Visitor&& visitor, WorkStealingPool& pool) const {
+        if (r == nullptr) return false;
+        std::deque<std::vector<std::vector<T>>> segments;
+        {
+            TaskGroup group(pool);
+            std::vector<T> current_path;
+            std::vector<std::pair<const NodeType*, std::size_t>> stack{{r, 0}};
+            std::uint64_t visits = 0;
+            while (!stack.empty()) {
+                const auto [node, depth] = stack.back();
+                stack.pop_back();
+                current_path.resize(depth);
+                if (node_size(node) < parallel_cutoff) {
+                    auto& segment = segments.emplace_back();
+                    group.run([this, node, &value, &segment, prefix = current_path] {
+                        collect_paths(node, value, prefix, [&segment](const std::vector<T>& path) { segment.push_back(path); });
+                    });
+                    continue;
+                }
+                ++visits;
+                current_path.push_back(node->data);
+                const Sides sides = sides_for(node, value);
+                if (sides.left && sides.right) segments.emplace_back().push_back(current_path);
+                if (node->right && sides.right) stack.emplace_back(node->right, depth + 1);
+                if (node->left && sides.left) stack.emplace_back(node->left, depth + 1);
+            }
+            group.wait();
+            tree_counters::count_visits(visits);
+        }
         bool found_any = false;
-        current_path.push_back(r->data);
+        for (const auto& segment : segments) {
+            for (const auto& path : segment) {
+                visitor(path);
+                found_any = true;
+            }
+        }
+        return found_any;
+    }
 
-        if (r->data == target) {
-            const int currentLevel = current_path.size() - 1;
-            if (currentLevel < minLevel) minLevel = currentLevel;
-            if (currentLevel > maxLevel) maxLevel = currentLevel;
+    // First node equal to value on its search path and the level it sits on (nullptr when
+    // absent). Counted mode keeps every copy in one node, so a single descent finds them all.
+    const NodeType* find_node(const NodeType* current, Key value, int& level) const {
+        level = 0;
+        while (current != nullptr) {
+            // Branch only on the rare equal case; the child is picked without a jump
+            const bool go_left = compare(value, current->data);
+            if (!go_left & !compare(current->data, value)) break;
+            current = go_left ? current->left : current->right;
+            ++level;
+        }
+        tree_counters::count_visits(static_cast<std::uint64_t>(level) + (current != nullptr));
+        return current;
+    }
+
+    // Descend to the insertion point of value remembering the links passed. Repeated values
+    // go left in chain mode; in counted mode they bump the node multiplicity here. Returns the
+    // empty link a new node belongs in, or nullptr when no node is needed.
+    NodeType** find_insert_link(const T& value, const bool repeat) {
+        const bool chain = repeat && duplicates == DuplicateMode::Chain;
+        insert_path.clear();
+        NodeType** link = &root;
+        while (*link != nullptr) {
+            NodeType* node = *link;
+            insert_path.push_back(link);
+            if (chain ? !compare(node->data, value) : compare(value, node->data)) link = &node->left;
+            else if (chain || compare(node->data, value)) link = &node->right;
+            else {
+                tree_counters::count_visits(insert_path.size());
+                if (!repeat) return nullptr;
+                ++node->count;
+                for (NodeType** visited : insert_path) ++(*visited)->size;
+                return nullptr;
+            }
+        }
+        tree_counters::count_visits(insert_path.size());
+        return link;
+    }
 
-            for (const auto& val : current_path) std::cout << val << " ";
-            std::cout << std::endl;
-            found_any = true;
+    // Descend to the first node equal to key, or to the empty link a node for key belongs in,
+    // remembering the links passed for link_new_node. The lookup and the insertion point of
+    // get/put/upsert come out of this one descent.
+    NodeType** find_key_link(const T& key) {
+        insert_path.clear();
+        NodeType** link = &root;
+        while (*link != nullptr) {
+            NodeType* node = *link;
+            const bool go_left = compare(key, node->data);
+            if (!go_left && !compare(node->data, key)) break;
+            insert_path.push_back(link);
+            link = go_left ? &node->left : &node->right;
         }
+        tree_counters::count_visits(insert_path.size() + (*link != nullptr));
+        return link;
+    }
 
-        const bool left = find_path(r->left, target, current_path, minLevel, maxLevel);
-        const bool right = find_path(r->right, target, current_path, minLevel, maxLevel);
+    // Hang created on the link found by find_insert_link, then retrace the path to update
+    // heights and rebalance
+    void link_new_node(NodeType** link, NodeType* created) {
+        const T& value = created->data;
+        *link = created;
+        if (min_node == nullptr || compare(value, min_node->data)) min_node = created;
+        if (max_node == nullptr || compare(max_node->data, value)) max_node = created;
 
-        current_path.pop_back();
-        return found_any || left || right;
+        auto it = insert_path.rbegin();
+        for (; it != insert_path.rend(); ++it) {
+            const int old_height = (**it)->height;
+            **it = rebalance(**it);
+            // Subtree height is unchanged, so above this point only sizes grow
+            if ((**it)->height == old_height) {
+                ++it;
+                break;
+            }
+        }
+        for (; it != insert_path.rend(); ++it) ++(**it)->size;
     }
 
-    Node<T>* insert_recursive_repeat(Node<T>* node, T value) {
-        if (node == nullptr) return new Node<T>(value);
-        if (value <= node->data) node->left = insert_recursive_repeat(node->left, value);
-        else node->right = insert_recursive_repeat(node->right, value);
-        return node;
+    // Remove a node equal to value, or only one of its copies in counted mode unless all is
+    // set, then retrace the path to update sizes and heights and rebalance, in O(height).
+    // The node goes back to the allocator (NodePool reuses it for the next insertion).
+    // Returns the number of values removed.
+    int erase_node(Key value, const bool all) {
+        insert_path.clear();
+        NodeType** link = &root;
+        while (*link != nullptr) {
+            NodeType* node = *link;
+            const bool go_left = compare(value, node->data);
+            if (!go_left & !compare(node->data, value)) break;
+            insert_path.push_back(link);
+            link = go_left ? &node->left : &node->right;
+        }
+        NodeType* target = *link;
+        tree_counters::count_visits(insert_path.size() + (target != nullptr));
+        if (target == nullptr) return 0;
+
+        if (!all && target->count > 1) {
+            --target->count;
+            --target->size;
+            for (NodeType** visited : insert_path) --(*visited)->size;
+            return 1;
+        }
+
+        const int removed = target->count;
+        // Path entries from here on are rebuilt exactly instead of shrinking by removed
+        std::size_t recompute_from = insert_path.size();
+        if (target->left == nullptr || target->right == nullptr) {
+            *link = target->left != nullptr ? target->left : target->right;
+        } else {
+            // The smallest node of the right subtree takes the place of target
+            insert_path.push_back(link);
+            const std::size_t below = insert_path.size();
+            NodeType** successor_link = &target->right;
+            while ((*successor_link)->left != nullptr) {
+                insert_path.push_back(successor_link);
+                successor_link = &(*successor_link)->left;
+            }
+            NodeType* successor = *successor_link;
+            tree_counters::count_visits(insert_path.size() - below + 1);
+            *successor_link = successor->right;
+            successor->left = target->left;
+            successor->right = target->right;
+            // Stale until retraced, like the rest of the path: it stands in for target there
+            successor->height = target->height;
+            successor->size = target->size;
+            *link = successor;
+            if (insert_path.size() > below) insert_path[below] = &successor->right;
+            // Nodes between target and successor lose the successor's copies, not target's
+            recompute_from = below;
+        }
+
+        std::size_t i = insert_path.size();
+        while (i > 0) {
+            NodeType** visited = insert_path[--i];
+            const int old_height = (*visited)->height;
+            *visited = rebalance(*visited);
+            // Subtree height is unchanged, so above this point only sizes shrink
+            if ((*visited)->height == old_height && i < recompute_from) break;
+        }
+        while (i > 0) (*insert_path[--i])->size -= removed;
+
+        if (target == min_node || target == max_node) refresh_extremes();
+        allocator.destroy(target);
+        return removed;
     }
 
-    Node<T>* insert_recursive(Node<T>* node, T value) {
-        if (node == nullptr) return new Node<T>(value);
-        if (value < node->data) node->left = insert_recursive(node->left, value);
-        else if (value > node->data) node->right = insert_recursive(node->right, value);
-        return node;
+    // Tree holding left, middle and right in that order; every value of left must be at most
+    // middle->data and every value of right at least. In AVL mode middle is hung off the
+    // spine of the taller tree where the heights meet and that spine is rebalanced, so this
+    // costs O(|height(left) - height(right)| + 1); otherwise middle simply becomes the root.
+    NodeType* join(NodeType* left, NodeType* middle, NodeType* right) {
+        const int left_height = node_height(left);
+        const int right_height = node_height(right);
+        if (balance != BalanceMode::AVL || std::abs(left_height - right_height) <= 1) {
+            middle->left = left;
+            middle->right = right;
+            update_node(middle);
+            return middle;
+        }
+        const bool left_taller = left_height > right_height;
+        NodeType* taller = left_taller ? left : right;
+        const int lower_height = left_taller ? right_height : left_height;
+        join_path.clear();
+        NodeType** link = &taller;
+        while (node_height(*link) > lower_height + 1) {
+            join_path.push_back(link);
+            link = left_taller ? &(*link)->right : &(*link)->left;
+        }
+        middle->left = left_taller ? *link : left;
+        middle->right = left_taller ? right : *link;
+        update_node(middle);
+        *link = middle;
+        for (auto it = join_path.rbegin(); it != join_path.rend(); ++it) **it = rebalance(**it);
+        return taller;
     }
 
-    int height_recursive(Node<T>* node, T value, const bool util) const {
-        if (node == nullptr) return -1;
-        if (node->data == value && util == true ) return -1;
-        const int left_height = height_recursive(node->left, value, util);
-        const int right_height = height_recursive(node->right, value, util);
+    // Tree holding left and then right; the smallest node of right joins them
+    NodeType* join(NodeType* left, NodeType* right) {
+        if (left == nullptr) return right;
+        if (right == nullptr) return left;
+        join_path.clear();
+        NodeType** link = &right;
+        while ((*link)->left != nullptr) {
+            join_path.push_back(link);
+            link = &(*link)->left;
+        }
+        NodeType* middle = *link;
+        *link = middle->right;
+        for (auto it = join_path.rbegin(); it != join_path.rend(); ++it) **it = rebalance(**it);
+        return join(left, middle, right);
+    }
+
+    // Split tree into the values below value (not above it when inclusive) and the rest.
+    // The nodes on the search path are joined back bottom-up; the join costs telescope, so
+    // the split is O(height).
+    std::pair<NodeType*, NodeType*> split(NodeType* tree, Key value, const bool inclusive) {
+        split_path.clear();
+        for (NodeType* node = tree; node != nullptr; ) {
+            const bool below = inclusive ? !compare(value, node->data) : compare(node->data, value);
+            split_path.emplace_back(node, below);
+            node = below ? node->right : node->left;
+        }
+        tree_counters::count_visits(split_path.size());
+        NodeType* low = nullptr;
+        NodeType* high = nullptr;
+        for (auto it = split_path.rbegin(); it != split_path.rend(); ++it) {
+            const auto [node, below] = *it;
+            if (below) low = join(node->left, node, low);
+            else high = join(high, node, node->right);
+        }
+        return {low, high};
+    }
+
+    // Contents of one node while the tree is rebuilt by insert_many
+    struct Entry {
+        T data;
+        [[no_unique_address]] mapped_type value;
+        int count;
+    };
+
+    // Build a height-optimal tree from entries already in inorder.
+    // Middle elements become roots; every subtree is filled in preorder from the pool, and
+    // the height of a subtree of k nodes built this way is bit_width(k) - 1.
+    NodeType* build_balanced(std::vector<Entry>& entries) {
+        struct Range { std::size_t lo, hi; NodeType** link; };
+        NodeType* result = nullptr;
+        if (entries.empty()) return result;
+        // Prefix sums of multiplicities give every subtree size in O(1)
+        std::vector<int> prefix(entries.size() + 1, 0);
+        for (std::size_t i = 0; i < entries.size(); ++i) prefix[i + 1] = prefix[i] + entries[i].count;
+        std::vector<Range> stack{{0, entries.size(), &result}};
+        while (!stack.empty()) {
+            const Range range = stack.back();
+            stack.pop_back();
+            const std::size_t mid = range.lo + (range.hi - range.lo) / 2;
+            Entry& entry = entries[mid];
+            NodeType* node;
+            if constexpr (std::is_void_v<V>) node = allocator.create(std::move(entry.data));
+            else node = allocator.create(std::piecewise_construct, std::move(entry.data), std::move(entry.value));
+            node->count = entry.count;
+            node->height = static_cast<int>(std::bit_width(range.hi - range.lo)) - 1;
+            node->size = prefix[range.hi] - prefix[range.lo];
+            *range.link = node;
+            if (mid + 1 < range.hi) stack.push_back({mid + 1, range.hi, &node->right});
+            if (range.lo < mid) stack.push_back({range.lo, mid, &node->left});
+        }
+        return result;
+    }
+
+    // Distinct values in order with their multiplicity. Chained copies of a value are
+    // contiguous in inorder even when rotations spread them over both sides of a node.
+    std::vector<std::pair<const NodeType*, int>> runs() const {
+        std::vector<std::pair<const NodeType*, int>> result;
+        std::vector<const NodeType*> stack;
+        std::uint64_t visits = 0;
+        for (const NodeType* node = root; node != nullptr || !stack.empty(); ) {
+            while (node != nullptr) {
+                stack.push_back(node);
+                node = node->left;
+            }
+            node = stack.back();
+            stack.pop_back();
+            ++visits;
+            if (!result.empty() && !compare(result.back().first->data, node->data)) result.back().second += node->count;
+            else result.emplace_back(node, node->count);
+            node = node->right;
+        }
+        tree_counters::count_visits(visits);
+        return result;
+    }
 
-        if (left_height > right_height) return left_height + 1;
-        return right_height + 1;
+    // A search for value visits about as many nodes as it has copies; fork only long runs
+    bool worth_forking(Key value) const {
+        return count_below(value, true) - count_below(value, false) >= parallel_cutoff;
+    }
+
+    // Number of stored values below value (not above it when inclusive), in O(height)
+    int count_below(Key value, const bool inclusive) const {
+        int below = 0;
+        std::uint64_t visits = 0;
+        for (const NodeType* node = root; node != nullptr; ++visits) {
+            if (inclusive ? !compare(value, node->data) : compare(node->data, value)) {
+                below += node_size(node->left) + node->count;
+                node = node->right;
+            } else {
+                node = node->left;
+            }
+        }
+        tree_counters::count_visits(visits);
+        return below;
+    }
+
+    // Print every value of range separated by spaces; each node is one visit however many copies it holds
+    template<typename Range>
+    static void print_range(const Range& range, std::ostream& out) {
+        std::uint64_t visits = 0;
+        const NodeType* last = nullptr;
+        for (auto it = range.begin(); it != range.end(); ++it) {
+            if (it.node() != last) {
+                last = it.node();
+                ++visits;
+            }
+            out << *it << " ";
+        }
+        out << std::endl;
+        tree_counters::count_visits(visits);
     }
 
 public:
     // Constructor to initialize the tree
-    BinaryTree() : root(nullptr) {}
+    explicit BinaryTree(const BalanceMode mode = BalanceMode::None,
+                        const DuplicateMode duplicate_mode = DuplicateMode::Chain,
+                        const Compare& comparator = Compare())
+        : root(nullptr), balance(mode), duplicates(duplicate_mode), compare(comparator) {}
     // Destructor
     ~BinaryTree() {
-        clear_recursive(root);
-        root = nullptr;
+        clear();
     }
     // Disable copying
     BinaryTree(const BinaryTree&) = delete;
     BinaryTree& operator=(const BinaryTree&) = delete;
-    BinaryTree(BinaryTree&&) = default;
-    BinaryTree& operator=(BinaryTree&&) = default;
+    BinaryTree(BinaryTree&& other) noexcept
+        : root(std::exchange(other.root, nullptr)), balance(other.balance),
+          duplicates(other.duplicates), allocator(std::move(other.allocator)), compare(std::move(other.compare)),
+          min_node(std::exchange(other.min_node, nullptr)), max_node(std::exchange(other.max_node, nullptr)) {}
+    BinaryTree& operator=(BinaryTree&& other) noexcept {
+        if (this != &other) {
+            clear();
+            root = std::exchange(other.root, nullptr);
+            balance = other.balance;
+            duplicates = other.duplicates;
+            allocator = std::move(other.allocator);
+            compare = std::move(other.compare);
+            min_node = std::exchange(other.min_node, nullptr);
+            max_node = std::exchange(other.max_node, nullptr);
+        }
+        return *this;
+    }
+
+    // Remove all nodes. A bulk-releasing allocator frees its blocks in one step;
+    // node destructors are only run when T (or V) actually needs them.
+    void clear() noexcept {
+        if constexpr (Allocator<NodeType>::releases_in_bulk) {
+            if constexpr (!std::is_trivially_destructible_v<NodeType>) {
+                clear_nodes(root, [](NodeType* node) { node->~NodeType(); });
+            }
+            allocator.release();
+        } else {
+            clear_nodes(root, [this](NodeType* node) { allocator.destroy(node); });
+        }
+        root = nullptr;
+        min_node = max_node = nullptr;
+    }
 
     // Access methods
-    Node<T> *get_root() { return root; }
-    const Node<T> *get_root() const { return root; }
+    NodeType *get_root() { return root; }
+    const NodeType *get_root() const { return root; }
+    [[nodiscard]] BalanceMode get_balance() const { return balance; }
+    [[nodiscard]] DuplicateMode get_duplicates() const { return duplicates; }
+    [[nodiscard]] bool empty() const { return root == nullptr; }
 
     // Methods to insert node in the binary tree (excluding the same elements)
-    void insert_node(T value, const bool repeat) {
-        if (!repeat) {
-            root = insert_recursive(root, value);
-            return;
+    void insert_node(const T& value, const bool repeat) {
+        if (NodeType** link = find_insert_link(value, repeat)) link_new_node(link, allocator.create(value));
+    }
+
+    // Same, moving value into the new node
+    void insert_node(T&& value, const bool repeat) {
+        if (NodeType** link = find_insert_link(value, repeat)) link_new_node(link, allocator.create(std::move(value)));
+    }
+
+    // Same, constructing the value in a fresh node from args. The node is returned to the
+    // allocator when the value turns out to be a counted or rejected duplicate.
+    template<typename... Args>
+    void emplace(const bool repeat, Args&&... args) {
+        NodeType* created = allocator.create(std::forward<Args>(args)...);
+        NodeType** link;
+        try {
+            link = find_insert_link(created->data, repeat);
+        } catch (...) {
+            allocator.destroy(created);
+            throw;
         }
-        root = insert_recursive_repeat(root, value);
+        if (link == nullptr) allocator.destroy(created);
+        else link_new_node(link, created);
+    }
+
+    // Remove one copy of value in O(height); returns whether value was present.
+    // Map trees remove the entry stored under key.
+    bool erase(Key value) {
+        return erase_node(value, false) != 0;
+    }
+
+    // Remove every copy of value; returns how many were removed, in O(height) plus one
+    // allocator release per removed node. Counted mode keeps the copies in one node. Chained
+    // copies are cut out as a whole: the tree is split around the run of value, the run is
+    // released and the two sides are joined again.
+    int erase_all(Key value) {
+        if (duplicates == DuplicateMode::Counted) return erase_node(value, true);
+        int level;
+        if (find_node(root, value, level) == nullptr) return 0;
+        const auto [below, rest] = split(root, value, false);
+        const auto [run, above] = split(rest, value, true);
+        const int removed = node_size(run);
+        clear_nodes(run, [this](NodeType* node) { allocator.destroy(node); });
+        root = join(below, above);
+        refresh_extremes();
+        return removed;
+    }
+
+    // Map trees: the value stored under key, or nullptr when key is absent, in O(height)
+    const mapped_type* get(Key key) const requires (!std::is_void_v<V>) {
+        int level;
+        const NodeType* node = find_node(root, key, level);
+        return node ? &node->value : nullptr;
+    }
+
+    mapped_type* get(Key key) requires (!std::is_void_v<V>) {
+        return const_cast<mapped_type*>(std::as_const(*this).get(key));
+    }
+
+    // Map trees: store value under key, replacing the value of an existing entry.
+    // Returns whether key was new.
+    bool put(T key, mapped_type value) requires (!std::is_void_v<V>) {
+        NodeType** link = find_key_link(key);
+        if (*link != nullptr) {
+            (*link)->value = std::move(value);
+            return false;
+        }
+        link_new_node(link, allocator.create(std::piecewise_construct, std::move(key), std::move(value)));
+        return true;
+    }
+
+    // Map trees: call update(value) on the value stored under key, adding key with a
+    // value-initialized value first when it is absent. Returns the updated value.
+    template<typename Update>
+    mapped_type& upsert(T key, Update&& update) requires (!std::is_void_v<V>) {
+        NodeType** link = find_key_link(key);
+        NodeType* node = *link;
+        if (node == nullptr) {
+            node = allocator.create(std::piecewise_construct, std::move(key), mapped_type());
+            link_new_node(link, node);
+        }
+        std::forward<Update>(update)(node->value);
+        return node->value;
+    }
+
+    // Bulk-insert a batch of values and rebuild the whole tree perfectly balanced.
+    // The batch is sorted unless it already is, merged with the current contents in one
+    // pass and rebuilt in O(n), honouring the same repeat/duplicate rules as insert_node.
+    // Map trees keep the values already stored; new keys get a value-initialized one.
+    void insert_many(std::vector<T> values, const bool repeat) {
+        if (!std::is_sorted(values.begin(), values.end(), compare)) std::sort(values.begin(), values.end(), compare);
+
+        // Current contents in order; nodes are released right after
+        std::vector<Entry> existing;
+        std::vector<NodeType*> stack;
+        for (NodeType* node = root; node != nullptr || !stack.empty(); ) {
+            while (node != nullptr) {
+                stack.push_back(node);
+                node = node->left;
+            }
+            node = stack.back();
+            stack.pop_back();
+            existing.push_back({std::move(node->data), std::move(node->value), node->count});
+            node = node->right;
+        }
+        tree_counters::count_visits(existing.size());
+        clear();
+
+        const bool counted = duplicates == DuplicateMode::Counted;
+        std::vector<Entry> entries;
+        entries.reserve(existing.size() + values.size());
+        auto next = existing.begin();
+        for (auto& value : values) {
+            while (next != existing.end() && !compare(value, next->data)) entries.push_back(std::move(*next++));
+            if (!entries.empty() && equivalent(entries.back().data, value)) {
+                if (!repeat) continue;
+                if (counted) {
+                    ++entries.back().count;
+                    continue;
+                }
+            }
+            entries.push_back({std::move(value), mapped_type(), 1});
+        }
+        std::move(next, existing.end(), std::back_inserter(entries));
+
+        root = build_balanced(entries);
+        refresh_extremes();
+    }
+
+    // Combine two trees into a new balanced tree in O(n + m): one merge pass over their
+    // distinct values in order, then build_balanced. Copies are counted per operand whatever
+    // its duplicate mode; the result takes the balance, duplicate mode and comparator of a,
+    // so in chain mode every resulting copy gets its own node.
+    static BinaryTree combine(const BinaryTree& a, const BinaryTree& b, const SetOperation operation)
+        requires std::is_void_v<V> {
+        const auto left = a.runs();
+        const auto right = b.runs();
+        const bool counted = a.duplicates == DuplicateMode::Counted;
+        std::vector<Entry> entries;
+        entries.reserve(left.size() + right.size());
+        auto add = [&](const T& value, const int copies) {
+            if (copies <= 0) return;
+            if (counted) entries.push_back({value, {}, copies});
+            else for (int i = 0; i < copies; ++i) entries.push_back({value, {}, 1});
+        };
+        std::size_t i = 0, j = 0;
+        while (i < left.size() || j < right.size()) {
+            const NodeType* node;
+            int in_a = 0, in_b = 0;
+            if (j == right.size() || (i < left.size() && a.compare(left[i].first->data, right[j].first->data))) {
+                node = left[i].first;
+                in_a = left[i++].second;
+            } else if (i == left.size() || a.compare(right[j].first->data, left[i].first->data)) {
+                node = right[j].first;
+                in_b = right[j++].second;
+            } else {
+                node = left[i].first;
+                in_a = left[i++].second;
+                in_b = right[j++].second;
+            }
+            switch (operation) {
+                case SetOperation::Merge: add(node->data, in_a + in_b); break;
+                case SetOperation::Union: add(node->data, std::max(in_a, in_b)); break;
+                case SetOperation::Intersection: add(node->data, std::min(in_a, in_b)); break;
+                case SetOperation::Difference: add(node->data, in_a - in_b); break;
+            }
+        }
+
+        BinaryTree result(a.balance, a.duplicates, a.compare);
+        result.root = result.build_balanced(entries);
+        result.refresh_extremes();
+        return result;
+    }
+
+    // Replace the contents with node_count nodes produced in preorder by next(node), which
+    // fills in node->data and node->count and returns {has_left, has_right}. The shape is
+    // taken as given (no comparisons or rebalancing); heights and sizes are recomputed.
+    template<typename Next>
+    void assign_preorder(const std::size_t node_count, Next&& next) {
+        clear();
+        std::vector<NodeType*> order;
+        order.reserve(node_count);
+        // Links still waiting for a node, the next one to fill on top
+        std::vector<NodeType**> pending;
+        if (node_count != 0) pending.push_back(&root);
+        try {
+            for (std::size_t i = 0; i < node_count; ++i) {
+                if (pending.empty()) throw std::runtime_error("Malformed preorder: too many nodes");
+                NodeType* node = allocator.create(T{});
+                *pending.back() = node;
+                pending.pop_back();
+                order.push_back(node);
+                const auto [has_left, has_right] = next(*node);
+                if (has_right) pending.push_back(&node->right);
+                if (has_left) pending.push_back(&node->left);
+            }
+            if (!pending.empty()) throw std::runtime_error("Malformed preorder: missing nodes");
+        } catch (...) {
+            // Unfilled links are still null, so the partial tree can be released as is
+            clear();
+            throw;
+        }
+        // Descendants follow their ancestor in preorder, so a reverse pass sees children first
+        for (auto it = order.rbegin(); it != order.rend(); ++it) update_node(*it);
+        refresh_extremes();
     }
 
     // Method to search for a value in the tree
-    bool search(T value) {
-        return search_recursive(root, value);
+    bool search(Key value) const {
+        int level;
+        return find_node(root, value, level) != nullptr;
+    }
+
+    // Inorder iteration over all stored values (range-for support)
+    using iterator = TreeIterator<T, TraversalOrder::Inorder, V>;
+    iterator begin() const { return iterator(root); }
+    iterator end() const { return iterator(); }
+
+    // Traversal views for range-for and std::ranges algorithms
+    TraversalRange<T, TraversalOrder::Inorder, V> inorder_range() const { return TraversalRange<T, TraversalOrder::Inorder, V>(root); }
+    TraversalRange<T, TraversalOrder::Preorder, V> preorder_range() const { return TraversalRange<T, TraversalOrder::Preorder, V>(root); }
+    TraversalRange<T, TraversalOrder::Postorder, V> postorder_range() const { return TraversalRange<T, TraversalOrder::Postorder, V>(root); }
+
+    // Inorder walk calling visitor(node, level) for every node; right_to_left mirrors the walk
+    template<typename Visitor>
+    void visit_with_levels(Visitor&& visitor, const bool right_to_left = false) const {
+        std::vector<std::pair<const NodeType*, int>> stack;
+        const NodeType* node = root;
+        int level = 0;
+        std::uint64_t visits = 0;
+        while (node != nullptr || !stack.empty()) {
+            while (node != nullptr) {
+                stack.emplace_back(node, level++);
+                node = right_to_left ? node->right : node->left;
+            }
+            const auto [current, currentLevel] = stack.back();
+            stack.pop_back();
+            ++visits;
+            visitor(*current, currentLevel);
+            node = right_to_left ? current->left : current->right;
+            level = currentLevel + 1;
+        }
+        tree_counters::count_visits(visits);
+    }
+
+    // Call visitor(path) with the root-to-node values of every node equal to value, in
+    // preorder; the level of a match is path.size() - 1. Returns whether any was found.
+    // Costs O(height + matches); with a pool, long chain-mode runs of value are split
+    // across its threads (same visit order).
+    template<typename Visitor>
+    bool visit_paths(Key value, Visitor&& visitor, WorkStealingPool* pool = nullptr) const {
+        std::vector<T> current_path;
+        // All copies share one node, so there is a single path
+        if (duplicates == DuplicateMode::Counted) {
+            int level;
+            const NodeType* target = find_node(root, value, level);
+            if (target == nullptr) return false;
+            for (const NodeType* node = root; ; node = compare(value, node->data) ? node->left : node->right) {
+                current_path.push_back(node->data);
+                if (node == target) break;
+            }
+            visitor(std::as_const(current_path));
+            return true;
+        }
+
+        if (pool != nullptr && worth_forking(value)) {
+            return collect_paths_parallel(root, value, visitor, *pool);
+        }
+        return collect_paths(root, value, std::move(current_path), visitor);
+    }
+
+    // Root-to-node values of every node equal to value, in preorder (empty when absent)
+    std::vector<std::vector<T>> paths(Key value, WorkStealingPool* pool = nullptr) const {
+        std::vector<std::vector<T>> result;
+        visit_paths(value, [&result](const std::vector<T>& path) { result.push_back(path); }, pool);
+        return result;
+    }
+
+    // Number of copies of value and the min/max level they occupy, in O(height + copies);
+    // with a pool, long chain-mode runs of value are split across its threads
+    EntryStats count(Key value, WorkStealingPool* pool = nullptr) const {
+        EntryStats stats;
+        if (duplicates == DuplicateMode::Counted) {
+            int level;
+            if (const NodeType* node = find_node(root, value, level)) {
+                stats.count = node->count;
+                stats.min_level = stats.max_level = level;
+            }
+        } else if (pool != nullptr && worth_forking(value)) {
+            count_entries_parallel(root, value, stats, *pool);
+        } else {
+            count_entries_helper(root, value, stats);
+        }
+        return stats;
     }
 
+    // Number of stored values, copies included, in O(1)
+    [[nodiscard]] int size() const {
+        return node_size(root);
+    }
+
+    // Number of stored values strictly less than value, in O(height)
+    [[nodiscard]] int rank(Key value) const {
+        return count_below(value, false);
+    }
+
+    // Number of stored values in [lo, hi], in O(height)
+    [[nodiscard]] int count_range(Key lo, Key hi) const {
+        if (compare(hi, lo)) return 0;
+        return count_below(hi, true) - count_below(lo, false);
+    }
+
+    // Inorder walk calling visitor(node) for every node whose value lies in [lo, hi].
+    // Subtrees entirely outside the range are never entered, so this is O(height + k).
+    template<typename Visitor>
+    void visit_range(Key lo, Key hi, Visitor&& visitor) const {
+        if (compare(hi, lo)) return;
+        std::vector<const NodeType*> stack;
+        const NodeType* node = root;
+        std::uint64_t visits = 0;
+        while (node != nullptr || !stack.empty()) {
+            while (node != nullptr) {
+                ++visits;
+                // Left of a node below lo holds nothing larger than it
+                if (compare(node->data, lo)) {
+                    node = node->right;
+                    continue;
+                }
+                stack.push_back(node);
+                node = node->left;
+            }
+            if (stack.empty()) break;
+            const NodeType* current = stack.back();
+            stack.pop_back();
+            // Inorder is sorted: once past hi, so is everything that follows
+            if (compare(hi, current->data)) break;
+            visitor(*current);
+            node = current->right;
+        }
+        tree_counters::count_visits(visits);
+    }
+
+    // Value at zero-based position k of the sorted sequence, in O(height)
+    const T& select(int k) const {
+        if (k < 0 || k >= size()) throw std::out_of_range("Index " + std::to_string(k) + " is out of range");
+        const NodeType* node = root;
+        for (std::uint64_t visits = 1; ; ++visits) {
+            const int left = node_size(node->left);
+            if (k < left) {
+                node = node->left;
+            } else if (k < left + node->count) {
+                tree_counters::count_visits(visits);
+                return node->data;
+            } else {
+                k -= left + node->count;
+                node = node->right;
+            }
+        }
+    }
+
+    // Height of the tree (-1 when empty), maintained per node so this is O(1)
+    [[nodiscard]] int height() const {
+        return node_height(root);
+    }
+
+    // Smallest and largest stored value in O(1) (T{} when empty)
+    T min() const { return min_node ? min_node->data : T{}; }
+    T max() const { return max_node ? max_node->data : T{}; }
+
     // Method to perform inorder traversal of the tree
-    void inorder() {
-        inorder_recursive(root);
-        std::cout << std::endl;
+    void inorder(std::ostream& out = std::cout) const {
+        print_range(inorder_range(), out);
     }
 
     // Method to perform preorder traversal of the tree
-    void preorder() {
-        preorderRecursive(root);
-        std::cout << std::endl;
+    void preorder(std::ostream& out = std::cout) const {
+        print_range(preorder_range(), out);
     }
 
-    // Method to print the tree
-    void print_tree() const {
-        print_tree_helper(root,0);
+    // Method to perform postorder traversal of the tree
+    void postorder(std::ostream& out = std::cout) const {
+        print_range(postorder_range(), out);
+    }
+
+    // Method to print the tree sideways: right subtree above its parent
+    void print_tree(std::ostream& out = std::cout) const {
+        visit_with_levels([&out](const NodeType& node, const int level) {
+            for (int i = 0; i < level; i++) {
+                out << "   ";
+            }
+            out << node.data;
+            if (node.count > 1) out << " (x" << node.count << ")";
+            out << std::endl;
+        }, true);
     }
 
     // Method of calculating the number of entries of a given element into a tree.
-    int count_entries(const T& value) const {
-        int counter = 0;
-        int minLevel = INT_MAX;
-        int maxLevel = -1;
-        count_entries_helper(root, counter, value, 0, minLevel, maxLevel);
-        std::cout << "Min level: " << minLevel << std::endl;
-        std::cout << "Max level: " << maxLevel << std::endl;
-        return counter;
+    int count_entries(Key value, std::ostream& out = std::cout, WorkStealingPool* pool = nullptr) const {
+        const EntryStats stats = count(value, pool);
+        out << "Min level: " << stats.min_level << std::endl;
+        out << "Max level: " << stats.max_level << std::endl;
+        return stats.count;
+    }
+
+    // Print the values in [lo, hi] in sorted order; returns how many were printed
+    int range(Key lo, Key hi, std::ostream& out = std::cout) const {
+        int printed = 0;
+        visit_range(lo, hi, [&](const NodeType& node) {
+            for (int i = 0; i < node.count; ++i) out << node.data << " ";
+            printed += node.count;
+        });
+        out << std::endl;
+        return printed;
     }
 
-    void find_levels() const{
-        std::cout << "Min level: 0" << std::endl;
-        std::cout << "Max level: " << height_recursive(root, 0, 0) << std::endl;
+    void find_levels(std::ostream& out = std::cout) const {
+        out << "Min level: 0" << std::endl;
+        out << "Max level: " << height() << std::endl;
     }
 
     // Method to search a path to a value in the tree
-    void get_path(T value) const {
-        std::vector<T> current_path;
+    void get_path(Key value, std::ostream& out = std::cout, WorkStealingPool* pool = nullptr) const {
         int minLevel = INT_MAX;
         int maxLevel = -1;
+        const bool found = visit_paths(value, [&](const std::vector<T>& path) {
+            const int currentLevel = static_cast<int>(path.size()) - 1;
+            if (currentLevel < minLevel) minLevel = currentLevel;
+            if (currentLevel > maxLevel) maxLevel = currentLevel;
 
-        if (const bool found = find_path(root, value, current_path, minLevel, maxLevel); !found) {
+            for (const auto& val : path) out << val << " ";
+            out << std::endl;
+        }, pool);
+        if (!found) {
             throw std::runtime_error("Not found");
         }
-        std::cout << "Min level: " << minLevel << std::endl;
-        std::cout << "Max level: " << maxLevel << std::endl;
+        out << "Min level: " << minLevel << std::endl;
+        out << "Max level: " << maxLevel << std::endl;
     }
 };
 
@@ -0,0 +1,535 @@
+//
+// B-tree backend with cache-line wide nodes and vectorized in-node search
+//
+
+#ifndef BTREE_H
+#define BTREE_H
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "lookup_key.h"
+#include "node_pool.h"
+#include "tree_counters.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace btree_detail {
+    // Keys per node: one 64-byte line for arithmetic keys, 16 otherwise
+    template<typename T>
+    constexpr int node_capacity() {
+        if constexpr (std::is_arithmetic_v<T>) return static_cast<int>(std::max<std::size_t>(64 / sizeof(T), 8));
+        else return 16;
+    }
+
+    // Bits set for the first n lanes
+    inline std::uint64_t lane_mask(const int n) {
+        return n >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << n) - 1;
+    }
+
+    // Number of keys[0..n) less than value, i.e. the position of the first key >= value.
+    // int, double and char compare the whole node with SSE2/AVX2 and count the set lanes;
+    // this works because keys are sorted, so all lanes below value form a prefix.
+    template<typename T, int Capacity>
+    int lower_bound(const T* keys, const int n, lookup_key_t<T> value) {
+#if defined(__SSE2__)
+        if constexpr (std::is_same_v<T, int>) {
+            std::uint64_t mask = 0;
+#if defined(__AVX2__)
+            const __m256i needle = _mm256_set1_epi32(value);
+            for (int i = 0; i < Capacity; i += 8) {
+                const __m256i block = _mm256_load_si256(reinterpret_cast<const __m256i*>(keys + i));
+                const __m256i less = _mm256_cmpgt_epi32(needle, block);
+                mask |= static_cast<std::uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(less))) << i;
+            }
+#else
+            const __m128i needle = _mm_set1_epi32(value);
+            for (int i = 0; i < Capacity; i += 4) {
+                const __m128i block = _mm_load_si128(reinterpret_cast<const __m128i*>(keys + i));
+                const __m128i less = _mm_cmplt_epi32(block, needle);
+                mask |= static_cast<std::uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(less))) << i;
+            }
+#endif
+            return std::popcount(mask & lane_mask(n));
+        } else if constexpr (std::is_same_v<T, double>) {
+            std::uint64_t mask = 0;
+#if defined(__AVX2__)
+            const __m256d needle = _mm256_set1_pd(value);
+            for (int i = 0; i < Capacity; i += 4) {
+                const __m256d less = _mm256_cmp_pd(_mm256_load_pd(keys + i), needle, _CMP_LT_OQ);
+                mask |= static_cast<std::uint64_t>(_mm256_movemask_pd(less)) << i;
+            }
+#else
+            const __m128d needle = _mm_set1_pd(value);
+            for (int i = 0; i < Capacity; i += 2) {
+                const __m128d less = _mm_cmplt_pd(_mm_load_pd(keys + i), needle);
+                mask |= static_cast<std::uint64_t>(_mm_movemask_pd(less)) << i;
+            }
+#endif
+            return std::popcount(mask & lane_mask(n));
+        } else if constexpr (std::is_same_v<T, char>) {
+            // SIMD byte compares are signed; flip the sign bit when char is unsigned
+            constexpr char bias = std::is_signed_v<char> ? 0 : static_cast<char>(0x80);
+            std::uint64_t mask = 0;
+#if defined(__AVX2__)
+            const __m256i flip = _mm256_set1_epi8(bias);
+            const __m256i needle = _mm256_xor_si256(_mm256_set1_epi8(value), flip);
+            for (int i = 0; i < Capacity; i += 32) {
+                const __m256i block = _mm256_xor_si256(
+                    _mm256_load_si256(reinterpret_cast<const __m256i*>(keys + i)), flip);
+                const auto bits = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(needle, block)));
+                mask |= static_cast<std::uint64_t>(bits) << i;
+            }
+#else
+            const __m128i flip = _mm_set1_epi8(bias);
+            const __m128i needle = _mm_xor_si128(_mm_set1_epi8(value), flip);
+            for (int i = 0; i < Capacity; i += 16) {
+                const __m128i block = _mm_xor_si128(
+                    _mm_load_si128(reinterpret_cast<const __m128i*>(keys + i)), flip);
+                const auto bits = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmplt_epi8(block, needle)));
+                mask |= static_cast<std::uint64_t>(bits) << i;
+            }
+#endif
+            return std::popcount(mask & lane_mask(n));
+        }
+#endif
+        // Scalar fallback (std::string and non-x86 targets)
+        return static_cast<int>(std::lower_bound(keys, keys + n, value) - keys);
+    }
+}
+
+// B-tree storing each distinct key once with its multiplicity. Nodes hold up to
+// Capacity sorted keys in one aligned block, so a lookup touches one line per level.
+template<typename T>
+class BTree {
+private:
+    static constexpr int Capacity = btree_detail::node_capacity<T>();
+    static_assert(Capacity >= 3, "B-tree nodes need room for at least three keys");
+    // Fewest keys a non-root node holds: the smaller half of a split
+    static constexpr int MinKeys = (Capacity - 1) / 2;
+
+    struct BNode {
+        alignas(64) T keys[Capacity]{};
+        int counts[Capacity]{};
+        BNode* children[Capacity + 1]{};
+        int n = 0;
+        bool leaf = true;
+    };
+
+    BNode* root = nullptr;
+    int levels = 0;            // Number of node levels (0 when empty)
+    std::size_t elements = 0;  // Total copies stored, duplicates included
+    NodePool<BNode> pool;
+
+    static int find_slot(const BNode* node, lookup_key_t<T> value) {
+        return btree_detail::lower_bound<T, Capacity>(node->keys, node->n, value);
+    }
+
+    // Split the full child at index i of a non-full parent around its median key
+    void split_child(BNode* parent, const int i) {
+        BNode* child = parent->children[i];
+        BNode* sibling = pool.create();
+        constexpr int mid = Capacity / 2;
+        sibling->leaf = child->leaf;
+        sibling->n = Capacity - mid - 1;
+        for (int j = 0; j < sibling->n; ++j) {
+            sibling->keys[j] = std::move(child->keys[mid + 1 + j]);
+            sibling->counts[j] = child->counts[mid + 1 + j];
+        }
+        if (!child->leaf) {
+            for (int j = 0; j <= sibling->n; ++j) sibling->children[j] = child->children[mid + 1 + j];
+        }
+        child->n = mid;
+
+        for (int j = parent->n; j > i; --j) {
+            parent->keys[j] = std::move(parent->keys[j - 1]);
+            parent->counts[j] = parent->counts[j - 1];
+            parent->children[j + 1] = parent->children[j];
+        }
+        parent->keys[i] = std::move(child->keys[mid]);
+        parent->counts[i] = child->counts[mid];
+        parent->children[i + 1] = sibling;
+        ++parent->n;
+    }
+
+    // Locate value, reporting the level of the node holding it
+    const BNode* find(lookup_key_t<T> value, int& index, int& level) const {
+        level = 0;
+        const BNode* found = nullptr;
+        for (const BNode* node = root; node != nullptr; node = node->children[index], ++level) {
+            index = find_slot(node, value);
+            if (index < node->n && node->keys[index] == value) {
+                found = node;
+                break;
+            }
+            if (node->leaf) break;
+        }
+        tree_counters::count_visits(root ? static_cast<std::uint64_t>(level) + 1 : 0);
+        return found;
+    }
+
+    // Drop key i of a leaf
+    static void remove_from_leaf(BNode* node, const int i) {
+        for (int j = i + 1; j < node->n; ++j) {
+            node->keys[j - 1] = std::move(node->keys[j]);
+            node->counts[j - 1] = node->counts[j];
+        }
+        --node->n;
+    }
+
+    // Move the last key of child i - 1 up into the parent and the separator down to the
+    // front of child i
+    static void borrow_from_left(BNode* parent, const int i) {
+        BNode* child = parent->children[i];
+        BNode* sibling = parent->children[i - 1];
+        for (int j = child->n; j > 0; --j) {
+            child->keys[j] = std::move(child->keys[j - 1]);
+            child->counts[j] = child->counts[j - 1];
+        }
+        if (!child->leaf) {
+            for (int j = child->n + 1; j > 0; --j) child->children[j] = child->children[j - 1];
+            child->children[0] = sibling->children[sibling->n];
+        }
+        child->keys[0] = std::move(parent->keys[i - 1]);
+        child->counts[0] = parent->counts[i - 1];
+        parent->keys[i - 1] = std::move(sibling->keys[sibling->n - 1]);
+        parent->counts[i - 1] = sibling->counts[sibling->n - 1];
+        ++child->n;
+        --sibling->n;
+    }
+
+    // Mirror image: the first key of child i + 1 goes up, the separator to the end of child i
+    static void borrow_from_right(BNode* parent, const int i) {
+        BNode* child = parent->children[i];
+        BNode* sibling = parent->children[i + 1];
+        child->keys[child->n] = std::move(parent->keys[i]);
+        child->counts[child->n] = parent->counts[i];
+        if (!child->leaf) child->children[child->n + 1] = sibling->children[0];
+        parent->keys[i] = std::move(sibling->keys[0]);
+        parent->counts[i] = sibling->counts[0];
+        for (int j = 1; j < sibling->n; ++j) {
+            sibling->keys[j - 1] = std::move(sibling->keys[j]);
+            sibling->counts[j - 1] = sibling->counts[j];
+        }
+        if (!sibling->leaf) {
+            for (int j = 1; j <= sibling->n; ++j) sibling->children[j - 1] = sibling->children[j];
+        }
+        ++child->n;
+        --sibling->n;
+    }
+
+    // Fold separator i and child i + 1 into child i; the emptied node returns to the pool
+    void merge_children(BNode* parent, const int i) {
+        BNode* child = parent->children[i];
+        BNode* sibling = parent->children[i + 1];
+        child->keys[child->n] = std::move(parent->keys[i]);
+        child->counts[child->n] = parent->counts[i];
+        for (int j = 0; j < sibling->n; ++j) {
+            child->keys[child->n + 1 + j] = std::move(sibling->keys[j]);
+            child->counts[child->n + 1 + j] = sibling->counts[j];
+        }
+        if (!child->leaf) {
+            for (int j = 0; j <= sibling->n; ++j) child->children[child->n + 1 + j] = sibling->children[j];
+        }
+        child->n += sibling->n + 1;
+        for (int j = i + 1; j < parent->n; ++j) {
+            parent->keys[j - 1] = std::move(parent->keys[j]);
+            parent->counts[j - 1] = parent->counts[j];
+            parent->children[j] = parent->children[j + 1];
+        }
+        --parent->n;
+        pool.destroy(sibling);
+    }
+
+    // Top-down deletion never enters a node that could underflow: child i gets an extra key
+    // from a sibling, or is merged with one. Returns the index of the child to descend into.
+    int fill_child(BNode* parent, const int i) {
+        if (parent->children[i]->n > MinKeys) return i;
+        if (i > 0 && parent->children[i - 1]->n > MinKeys) {
+            borrow_from_left(parent, i);
+            return i;
+        }
+        if (i < parent->n && parent->children[i + 1]->n > MinKeys) {
+            borrow_from_right(parent, i);
+            return i;
+        }
+        if (i < parent->n) {
+            merge_children(parent, i);
+            return i;
+        }
+        merge_children(parent, i - 1);
+        return i - 1;
+    }
+
+    // Remove the largest (or smallest) key of the subtree at node, which holds more than
+    // MinKeys keys, and return it with its count
+    std::pair<T, int> take_extreme(BNode* node, const bool largest, std::uint64_t& visits) {
+        for (; !node->leaf; ++visits) node = node->children[fill_child(node, largest ? node->n : 0)];
+        const int i = largest ? node->n - 1 : 0;
+        std::pair<T, int> result{std::move(node->keys[i]), node->counts[i]};
+        remove_from_leaf(node, i);
+        return result;
+    }
+
+    // Remove the key equal to value, with all its copies, in one top-down pass. The key
+    // must be present. A key in an inner node is replaced by its predecessor or successor.
+    void remove_key(lookup_key_t<T> value) {
+        BNode* node = root;
+        std::uint64_t visits = 1;
+        for (; ; ++visits) {
+            int i = find_slot(node, value);
+            if (i < node->n && node->keys[i] == value) {
+                if (node->leaf) {
+                    remove_from_leaf(node, i);
+                    break;
+                }
+                if (node->children[i]->n > MinKeys || node->children[i + 1]->n > MinKeys) {
+                    const bool from_left = node->children[i]->n > MinKeys;
+                    auto [key, count] = take_extreme(node->children[from_left ? i : i + 1], from_left, visits);
+                    node->keys[i] = std::move(key);
+                    node->counts[i] = count;
+                    break;
+                }
+                // Both neighbours are minimal: merge them around the key and delete it below
+                merge_children(node, i);
+                node = node->children[i];
+                continue;
+            }
+            node = node->children[fill_child(node, i)];
+        }
+        tree_counters::count_visits(visits);
+
+        // A merge can empty the root; the tree then loses a level
+        if (root->n == 0) {
+            BNode* old_root = root;
+            root = root->leaf ? nullptr : root->children[0];
+            pool.destroy(old_root);
+            --levels;
+        }
+    }
+
+    // Shared body of the insert_node overloads; value is only moved once its slot is known
+    template<typename V>
+    void insert_value(V&& value, const bool repeat) {
+        if (root == nullptr) {
+            root = pool.create();
+            levels = 1;
+        }
+        if (root->n == Capacity) {
+            BNode* new_root = pool.create();
+            new_root->leaf = false;
+            new_root->children[0] = root;
+            root = new_root;
+            split_child(root, 0);
+            ++levels;
+        }
+        // Top-down: every full node on the way is split before descending into it
+        BNode* node = root;
+        for (std::uint64_t visits = 1; ; ++visits) {
+            int i = find_slot(node, value);
+            if (i < node->n && node->keys[i] == value) {
+                tree_counters::count_visits(visits);
+                if (repeat) {
+                    ++node->counts[i];
+                    ++elements;
+                }
+                return;
+            }
+            if (node->leaf) {
+                tree_counters::count_visits(visits);
+                for (int j = node->n; j > i; --j) {
+                    node->keys[j] = std::move(node->keys[j - 1]);
+                    node->counts[j] = node->counts[j - 1];
+                }
+                node->keys[i] = std::forward<V>(value);
+                node->counts[i] = 1;
+                ++node->n;
+                ++elements;
+                return;
+            }
+            if (node->children[i]->n == Capacity) {
+                split_child(node, i);
+                if (node->keys[i] == value) continue;
+                if (node->keys[i] < value) ++i;
+            }
+            node = node->children[i];
+        }
+    }
+
+public:
+    BTree() = default;
+    ~BTree() { clear(); }
+    BTree(const BTree&) = delete;
+    BTree& operator=(const BTree&) = delete;
+
+    // Insert a value; a repeated value increments its count when repeat is set
+    void insert_node(const T& value, const bool repeat) {
+        insert_value(value, repeat);
+    }
+
+    // Same, moving value into its slot
+    void insert_node(T&& value, const bool repeat) {
+        insert_value(std::move(value), repeat);
+    }
+
+    // Insert a batch in sorted order (keeps the descent warm in cache)
+    void insert_many(std::vector<T> values, const bool repeat) {
+        if (!std::is_sorted(values.begin(), values.end())) std::sort(values.begin(), values.end());
+        for (auto& value : values) insert_node(std::move(value), repeat);
+    }
+
+    // Remove one copy of value in O(height); returns whether it was present
+    bool erase(lookup_key_t<T> value) {
+        int index, level;
+        BNode* node = const_cast<BNode*>(find(value, index, level));
+        if (node == nullptr) return false;
+        --elements;
+        if (node->counts[index] > 1) --node->counts[index];
+        else remove_key(value);
+        return true;
+    }
+
+    // Remove every copy of value in O(height); returns how many were removed
+    int erase_all(lookup_key_t<T> value) {
+        int index, level;
+        const BNode* node = find(value, index, level);
+        if (node == nullptr) return 0;
+        const int removed = node->counts[index];
+        elements -= removed;
+        remove_key(value);
+        return removed;
+    }
+
+    bool search(lookup_key_t<T> value) const {
+        int index, level;
+        return find(value, index, level) != nullptr;
+    }
+
+    // Same output as BinaryTree::count_entries; all copies share one slot and level
+    int count_entries(lookup_key_t<T> value, std::ostream& out = std::cout) const {
+        int index, level;
+        const BNode* node = find(value, index, level);
+        out << "Min level: " << (node ? level : INT_MAX) << std::endl;
+        out << "Max level: " << (node ? level : -1) << std::endl;
+        return node ? node->counts[index] : 0;
+    }
+
+    // Stack entries are (node, next child index); key i-1 is printed right before child i
+    void inorder(std::ostream& out = std::cout) const {
+        std::vector<std::pair<const BNode*, int>> stack;
+        if (root != nullptr) stack.emplace_back(root, 0);
+        while (!stack.empty()) {
+            const BNode* node = stack.back().first;
+            const int index = stack.back().second++;
+            if (index > node->n) {
+                stack.pop_back();
+                continue;
+            }
+            if (index > 0) {
+                for (int c = 0; c < node->counts[index - 1]; ++c) out << node->keys[index - 1] << " ";
+            }
+            if (!node->leaf) stack.emplace_back(node->children[index], 0);
+        }
+        out << std::endl;
+    }
+
+    // Node keys first, then the child subtrees left to right
+    void preorder(std::ostream& out = std::cout) const {
+        std::vector<const BNode*> stack;
+        if (root != nullptr) stack.push_back(root);
+        while (!stack.empty()) {
+            const BNode* node = stack.back();
+            stack.pop_back();
+            for (int i = 0; i < node->n; ++i) {
+                for (int c = 0; c < node->counts[i]; ++c) out << node->keys[i] << " ";
+            }
+            if (!node->leaf) {
+                for (int i = node->n; i >= 0; --i) stack.push_back(node->children[i]);
+            }
+        }
+        out << std::endl;
+    }
+
+    // Sideways print like BinaryTree::print_tree: upper half of the children above the node
+    void print_tree(std::ostream& out = std::cout) const {
+        struct Item { const BNode* node; int level; bool emit; };
+        std::vector<Item> stack;
+        if (root != nullptr) stack.push_back({root, 0, false});
+        while (!stack.empty()) {
+            const Item item = stack.back();
+            stack.pop_back();
+            const BNode* node = item.node;
+            if (item.emit) {
+                for (int i = 0; i < item.level; i++) out << "   ";
+                out << "[";
+                for (int i = 0; i < node->n; ++i) {
+                    out << (i ? " " : "") << node->keys[i];
+                    if (node->counts[i] > 1) out << " (x" << node->counts[i] << ")";
+                }
+                out << "]" << std::endl;
+                continue;
+            }
+            if (node->leaf) {
+                stack.push_back({node, item.level, true});
+                continue;
+            }
+            const int half = node->n / 2;
+            for (int i = 0; i <= half; ++i) stack.push_back({node->children[i], item.level + 1, false});
+            stack.push_back({node, item.level, true});
+            for (int i = half + 1; i <= node->n; ++i) stack.push_back({node->children[i], item.level + 1, false});
+        }
+    }
+
+    // Height in the same convention as BinaryTree: a single node has height 0
+    [[nodiscard]] int height() const { return levels - 1; }
+
+    void find_levels(std::ostream& out = std::cout) const {
+        out << "Min level: 0" << std::endl;
+        out << "Max level: " << height() << std::endl;
+    }
+
+    [[nodiscard]] bool empty() const { return elements == 0; }
+    [[nodiscard]] std::size_t size() const { return elements; }
+
+    T min() const {
+        const BNode* node = root;
+        if (node == nullptr) return T{};
+        while (!node->leaf) node = node->children[0];
+        return node->keys[0];
+    }
+
+    T max() const {
+        const BNode* node = root;
+        if (node == nullptr) return T{};
+        while (!node->leaf) node = node->children[node->n];
+        return node->keys[node->n - 1];
+    }
+
+    void clear() noexcept {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            std::vector<BNode*> stack;
+            if (root != nullptr) stack.push_back(root);
+            while (!stack.empty()) {
+                BNode* node = stack.back();
+                stack.pop_back();
+                if (!node->leaf) {
+                    for (int i = 0; i <= node->n; ++i) stack.push_back(node->children[i]);
+                }
+                node->~BNode();
+            }
+        }
+        pool.release();
+        root = nullptr;
+        levels = 0;
+        elements = 0;
+    }
+};
+
+#endif //BTREE_H
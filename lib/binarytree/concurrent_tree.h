@@ -0,0 +1,299 @@
+//
+// Thread-safe tree: RCU-style lock-free readers, one writer at a time
+//
+
+#ifndef CONCURRENT_TREE_H
+#define CONCURRENT_TREE_H
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "binary_tree.h"
+#include "lookup_key.h"
+#include "node_pool.h"
+
+// Immutable once published: writers never modify a node readers can reach,
+// they copy the root-to-leaf path instead (path copying)
+template<typename T>
+struct ConcurrentNode {
+    T data;
+    const ConcurrentNode* left;
+    const ConcurrentNode* right;
+    int height;
+    int count;
+    int size;
+
+    ConcurrentNode(T value, const int copies, const ConcurrentNode* l, const ConcurrentNode* r)
+        : data(std::move(value)), left(l), right(r),
+          height(1 + std::max(l ? l->height : -1, r ? r->height : -1)),
+          count(copies), size(copies + (l ? l->size : 0) + (r ? r->size : 0)) {}
+};
+
+// AVL tree shared between many reader threads and any number of writers.
+//
+// Readers take no locks: each Reader owns a cache-line padded slot where it announces
+// the epoch it entered in, then walks whatever root was published. Writers serialize on
+// a mutex, build a new version by copying the O(log n) nodes on the insertion path,
+// publish it with one atomic store and retire the replaced nodes. A retired node is
+// freed once every active reader has announced a later epoch (epoch-based reclamation).
+template<typename T>
+class ConcurrentTree {
+public:
+    using NodeType = ConcurrentNode<T>;
+
+private:
+    struct alignas(64) ReaderSlot {
+        std::atomic<std::uint64_t> epoch{0};  // 0 while the reader is outside a read
+        std::atomic<bool> claimed{false};
+    };
+
+    std::atomic<const NodeType*> root{nullptr};
+    std::atomic<std::uint64_t> global_epoch{1};
+    std::unique_ptr<ReaderSlot[]> slots;
+    std::size_t max_readers;
+    DuplicateMode duplicates;
+
+    // Writer-side state, guarded by writer_mutex
+    std::mutex writer_mutex;
+    NodePool<NodeType> pool;
+    std::vector<std::pair<const NodeType*, std::uint64_t>> retired;
+    std::vector<std::pair<const NodeType*, bool>> insert_path;
+
+    // Retired nodes are reclaimed in batches so slots are not scanned on every write
+    static constexpr std::size_t reclaim_threshold = 1024;
+
+    static int height_of(const NodeType* node) { return node ? node->height : -1; }
+
+    const NodeType* make(const T& data, const int count, const NodeType* left, const NodeType* right) {
+        return pool.create(data, count, left, right);
+    }
+
+    void retire(const NodeType* node) {
+        retired.emplace_back(node, global_epoch.load(std::memory_order_seq_cst));
+    }
+
+    // New node with the given contents whose children differ in height by at most two,
+    // rotated back into AVL shape where needed. Replaced children are retired.
+    const NodeType* balance(const T& data, const int count, const NodeType* left, const NodeType* right) {
+        if (height_of(left) > height_of(right) + 1) {
+            if (height_of(left->left) >= height_of(left->right)) {
+                retire(left);
+                return make(left->data, left->count, left->left, make(data, count, left->right, right));
+            }
+            const NodeType* pivot = left->right;
+            retire(left);
+            retire(pivot);
+            return make(pivot->data, pivot->count,
+                        make(left->data, left->count, left->left, pivot->left),
+                        make(data, count, pivot->right, right));
+        }
+        if (height_of(right) > height_of(left) + 1) {
+            if (height_of(right->right) >= height_of(right->left)) {
+                retire(right);
+                return make(right->data, right->count, make(data, count, left, right->left), right->right);
+            }
+            const NodeType* pivot = right->left;
+            retire(right);
+            retire(pivot);
+            return make(pivot->data, pivot->count,
+                        make(data, count, left, pivot->left),
+                        make(right->data, right->count, pivot->right, right->right));
+        }
+        return make(data, count, left, right);
+    }
+
+    // Build the next version with value inserted; returns the new root (or the old one if unchanged)
+    const NodeType* insert_version(const NodeType* current, const T& value, const bool repeat) {
+        const bool chain = repeat && duplicates == DuplicateMode::Chain;
+        insert_path.clear();
+        const NodeType* replacement = nullptr;
+        for (const NodeType* node = current; node != nullptr; ) {
+            if (chain ? value <= node->data : value < node->data) {
+                insert_path.emplace_back(node, true);
+                node = node->left;
+            } else if (chain || node->data < value) {
+                insert_path.emplace_back(node, false);
+                node = node->right;
+            } else {
+                if (!repeat) return current;
+                replacement = make(node->data, node->count + 1, node->left, node->right);
+                retire(node);
+                break;
+            }
+        }
+        if (replacement == nullptr) replacement = make(value, 1, nullptr, nullptr);
+
+        // Copy the path bottom-up, rebalancing each copy
+        for (auto it = insert_path.rbegin(); it != insert_path.rend(); ++it) {
+            const auto [node, went_left] = *it;
+            replacement = went_left ? balance(node->data, node->count, replacement, node->right)
+                                    : balance(node->data, node->count, node->left, replacement);
+            retire(node);
+        }
+        return replacement;
+    }
+
+    // Make a new version visible, then free whatever no reader can still see
+    void publish(const NodeType* next) {
+        root.store(next, std::memory_order_seq_cst);
+        global_epoch.fetch_add(1, std::memory_order_seq_cst);
+        if (retired.size() >= reclaim_threshold) reclaim();
+    }
+
+    void reclaim() {
+        std::uint64_t oldest = UINT64_MAX;
+        for (std::size_t i = 0; i < max_readers; ++i) {
+            const std::uint64_t epoch = slots[i].epoch.load(std::memory_order_seq_cst);
+            if (epoch != 0) oldest = std::min(oldest, epoch);
+        }
+        std::erase_if(retired, [&](const auto& entry) {
+            if (entry.second >= oldest) return false;
+            pool.destroy(const_cast<NodeType*>(entry.first));
+            return true;
+        });
+    }
+
+public:
+    explicit ConcurrentTree(const DuplicateMode duplicate_mode = DuplicateMode::Chain, const std::size_t readers = 128)
+        : slots(std::make_unique<ReaderSlot[]>(readers)), max_readers(readers), duplicates(duplicate_mode) {}
+
+    // All Reader handles must be gone before the tree is destroyed
+    ~ConcurrentTree() {
+        std::vector<const NodeType*> stack;
+        if (const NodeType* node = root.load()) stack.push_back(node);
+        while (!stack.empty()) {
+            const NodeType* node = stack.back();
+            stack.pop_back();
+            if (node->left) stack.push_back(node->left);
+            if (node->right) stack.push_back(node->right);
+            pool.destroy(const_cast<NodeType*>(node));
+        }
+        for (const auto& entry : retired) pool.destroy(const_cast<NodeType*>(entry.first));
+    }
+
+    ConcurrentTree(const ConcurrentTree&) = delete;
+    ConcurrentTree& operator=(const ConcurrentTree&) = delete;
+
+    // Insert a value; concurrent readers keep seeing the previous version until it is published
+    void insert_node(const T& value, const bool repeat) {
+        std::lock_guard lock(writer_mutex);
+        const NodeType* current = root.load(std::memory_order_relaxed);
+        const NodeType* next = insert_version(current, value, repeat);
+        if (next != current) publish(next);
+    }
+
+    // Apply a batch under one lock and publish it as a single version
+    void insert_many(const std::vector<T>& values, const bool repeat) {
+        std::lock_guard lock(writer_mutex);
+        const NodeType* current = root.load(std::memory_order_relaxed);
+        const NodeType* next = current;
+        for (const auto& value : values) next = insert_version(next, value, repeat);
+        if (next != current) publish(next);
+    }
+
+    // Per-thread read handle. Create one in each reading thread; it must not be shared.
+    class Reader {
+    private:
+        const ConcurrentTree* tree;
+        ReaderSlot* slot;
+
+        // Pin the current epoch for the duration of f(root)
+        template<typename F>
+        decltype(auto) read(F&& f) const {
+            slot->epoch.store(tree->global_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+            struct Unpin {
+                ReaderSlot* s;
+                ~Unpin() { s->epoch.store(0, std::memory_order_release); }
+            } unpin{slot};
+            return f(tree->root.load(std::memory_order_seq_cst));
+        }
+
+    public:
+        explicit Reader(const ConcurrentTree& owner) : tree(&owner), slot(nullptr) {
+            for (std::size_t i = 0; i < owner.max_readers; ++i) {
+                bool expected = false;
+                if (owner.slots[i].claimed.compare_exchange_strong(expected, true)) {
+                    slot = &owner.slots[i];
+                    return;
+                }
+            }
+            throw std::runtime_error("Too many concurrent readers");
+        }
+        ~Reader() { slot->claimed.store(false, std::memory_order_release); }
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        bool search(lookup_key_t<T> value) const {
+            return read([&](const NodeType* node) {
+                while (node != nullptr) {
+                    if (node->data == value) return true;
+                    node = value < node->data ? node->left : node->right;
+                }
+                return false;
+            });
+        }
+
+        // Copies of value and their min/max level; equal keys can sit on both sides
+        // of each other after rotations, so both children of a match are explored
+        EntryStats count(lookup_key_t<T> value) const {
+            return read([&](const NodeType* node) {
+                EntryStats stats;
+                std::vector<std::pair<const NodeType*, int>> stack;
+                if (node) stack.emplace_back(node, 0);
+                while (!stack.empty()) {
+                    const auto [current, level] = stack.back();
+                    stack.pop_back();
+                    if (value < current->data) {
+                        if (current->left) stack.emplace_back(current->left, level + 1);
+                    } else if (current->data < value) {
+                        if (current->right) stack.emplace_back(current->right, level + 1);
+                    } else {
+                        stats.count += current->count;
+                        stats.min_level = std::min(stats.min_level, level);
+                        stats.max_level = std::max(stats.max_level, level);
+                        if (current->right) stack.emplace_back(current->right, level + 1);
+                        if (current->left) stack.emplace_back(current->left, level + 1);
+                    }
+                }
+                return stats;
+            });
+        }
+
+        // Root-to-node value paths of every copy of value, in preorder
+        std::vector<std::vector<T>> paths(lookup_key_t<T> value) const {
+            return read([&](const NodeType* node) {
+                std::vector<std::vector<T>> result;
+                std::vector<T> current_path;
+                std::vector<std::pair<const NodeType*, std::size_t>> stack;
+                if (node) stack.emplace_back(node, 0);
+                while (!stack.empty()) {
+                    const auto [current, depth] = stack.back();
+                    stack.pop_back();
+                    current_path.resize(depth);
+                    current_path.push_back(current->data);
+                    const bool go_left = !(current->data < value);
+                    const bool go_right = !(value < current->data);
+                    if (go_left && go_right) result.push_back(current_path);
+                    if (go_right && current->right) stack.emplace_back(current->right, depth + 1);
+                    if (go_left && current->left) stack.emplace_back(current->left, depth + 1);
+                }
+                return result;
+            });
+        }
+
+        [[nodiscard]] int size() const {
+            return read([](const NodeType* node) { return node ? node->size : 0; });
+        }
+
+        [[nodiscard]] int height() const {
+            return read([](const NodeType* node) { return height_of(node); });
+        }
+    };
+};
+
+#endif //CONCURRENT_TREE_H
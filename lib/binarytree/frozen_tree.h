@@ -0,0 +1,155 @@
+//
+// Read-only snapshot of a BinaryTree in Eytzinger (BFS) array layout
+//
+
+#ifndef FROZEN_TREE_H
+#define FROZEN_TREE_H
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cstddef>
+#include <iostream>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "binary_tree.h"
+#include "tree_counters.h"
+
+// Minimal allocator returning cache-line aligned storage, so that keys prefetched
+// together in FrozenTree::lower_bound share one line
+template<typename T, std::size_t Alignment = 64>
+struct CacheAlignedAllocator {
+    using value_type = T;
+
+    CacheAlignedAllocator() = default;
+    template<typename U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U, Alignment>&) noexcept {}
+
+    template<typename U>
+    struct rebind { using other = CacheAlignedAllocator<U, Alignment>; };
+
+    T* allocate(const std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{Alignment}));
+    }
+
+    void deallocate(T* p, std::size_t) noexcept {
+        ::operator delete(p, std::align_val_t{Alignment});
+    }
+
+    bool operator==(const CacheAlignedAllocator&) const noexcept { return true; }
+};
+
+// Immutable search structure compiled from a tree. Distinct keys are stored in
+// Eytzinger order (children of slot k are 2k and 2k+1, slot 0 unused), together
+// with their multiplicity and the min/max level their copies had in the source tree.
+template<typename T>
+class FrozenTree {
+private:
+    std::vector<T, CacheAlignedAllocator<T>> keys;
+    std::vector<int> counts;
+    std::vector<int> min_levels;
+    std::vector<int> max_levels;
+    std::size_t n = 0;
+
+    // How many slots ahead the descent prefetches: keys of a subtree four levels down
+    // are contiguous (16 slots starting at 16k), one cache line for 4-byte keys
+    static constexpr std::size_t prefetch_stride = 16;
+
+    // Branchless descent; returns the slot of the first key not less than value, or 0
+    std::size_t lower_bound(lookup_key_t<T> value) const {
+        std::size_t k = 1;
+        while (k <= n) {
+#if defined(__GNUC__) || defined(__clang__)
+            if constexpr (std::is_arithmetic_v<T>) {
+                __builtin_prefetch(keys.data() + std::min(k * prefetch_stride, n));
+            }
+#endif
+            k = 2 * k + static_cast<std::size_t>(keys[k] < value);
+        }
+        // Each level of the descent appended one bit to k
+        tree_counters::count_visits(std::bit_width(k) - 1);
+        // Undo the trailing right turns plus the final left turn
+        return k >> (std::countr_one(k) + 1);
+    }
+
+    // Slot holding value, or 0 when absent
+    std::size_t find(lookup_key_t<T> value) const {
+        const std::size_t k = lower_bound(value);
+        return k != 0 && keys[k] == value ? k : 0;
+    }
+
+public:
+    FrozenTree() = default;
+
+    // Compile a snapshot of the tree rooted at root
+    explicit FrozenTree(const Node<T>* root) {
+        // Inorder walk collapsing equal keys (chain mode keeps them in separate nodes)
+        std::vector<T> sorted;
+        std::vector<int> sorted_counts, sorted_min, sorted_max;
+        std::vector<std::pair<const Node<T>*, int>> stack;
+        const Node<T>* node = root;
+        int level = 0;
+        while (node != nullptr || !stack.empty()) {
+            while (node != nullptr) {
+                stack.emplace_back(node, level++);
+                node = node->left;
+            }
+            const auto [current, current_level] = stack.back();
+            stack.pop_back();
+            if (!sorted.empty() && sorted.back() == current->data) {
+                sorted_counts.back() += current->count;
+                sorted_min.back() = std::min(sorted_min.back(), current_level);
+                sorted_max.back() = std::max(sorted_max.back(), current_level);
+            } else {
+                sorted.push_back(current->data);
+                sorted_counts.push_back(current->count);
+                sorted_min.push_back(current_level);
+                sorted_max.push_back(current_level);
+            }
+            node = current->right;
+            level = current_level + 1;
+        }
+
+        // Distribute sorted keys over the implicit tree with an inorder walk of slot numbers
+        n = sorted.size();
+        keys.resize(n + 1);
+        counts.resize(n + 1);
+        min_levels.resize(n + 1);
+        max_levels.resize(n + 1);
+        std::vector<std::size_t> slots;
+        std::size_t next = 0;
+        std::size_t k = 1;
+        while (k <= n || !slots.empty()) {
+            while (k <= n) {
+                slots.push_back(k);
+                k = 2 * k;
+            }
+            k = slots.back();
+            slots.pop_back();
+            keys[k] = std::move(sorted[next]);
+            counts[k] = sorted_counts[next];
+            min_levels[k] = sorted_min[next];
+            max_levels[k] = sorted_max[next];
+            ++next;
+            k = 2 * k + 1;
+        }
+    }
+
+    // Number of distinct keys in the snapshot
+    [[nodiscard]] std::size_t size() const { return n; }
+
+    bool search(lookup_key_t<T> value) const {
+        return find(value) != 0;
+    }
+
+    // Same contract and output as BinaryTree::count_entries
+    int count_entries(lookup_key_t<T> value, std::ostream& out = std::cout) const {
+        const std::size_t k = find(value);
+        out << "Min level: " << (k ? min_levels[k] : INT_MAX) << std::endl;
+        out << "Max level: " << (k ? max_levels[k] : -1) << std::endl;
+        return k ? counts[k] : 0;
+    }
+};
+
+#endif //FROZEN_TREE_H
@@ -0,0 +1,26 @@
+//
+// Argument type used by tree lookups
+//
+
+#ifndef LOOKUP_KEY_H
+#define LOOKUP_KEY_H
+#include <string>
+#include <string_view>
+
+// Lookups (search, count, paths, rank, ranges) take lookup_key_t<T>. For std::string trees
+// that is std::string_view, so a literal, a parsed token or a slice of a larger buffer is
+// compared in place without building a std::string first. Other types use const T&.
+template<typename T>
+struct lookup_key {
+    using type = const T&;
+};
+
+template<>
+struct lookup_key<std::string> {
+    using type = std::string_view;
+};
+
+template<typename T>
+using lookup_key_t = typename lookup_key<T>::type;
+
+#endif //LOOKUP_KEY_H
@@ -0,0 +1,122 @@
+//
+// Node allocators used by BinaryTree
+//
+
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+#include "tree_counters.h"
+
+// Slab allocator: nodes are carved out of contiguous blocks, freed nodes are kept
+// in an intrusive free list and reused, and release() drops every block at once.
+template<typename NodeT>
+class NodePool {
+private:
+    // Storage for a single node; while the slot is free it holds the free list link
+    union Slot {
+        Slot* next;
+        alignas(NodeT) unsigned char storage[sizeof(NodeT)];
+    };
+
+    // Block sizes grow geometrically from first_block up to max_block slots
+    static constexpr std::size_t first_block = 32;
+    static constexpr std::size_t max_block = 4096;
+
+    std::vector<std::unique_ptr<Slot[]>> blocks;
+    Slot* cursor = nullptr;     // Next never-used slot in the newest block
+    Slot* block_end = nullptr;  // End of the newest block
+    Slot* free_list = nullptr;  // Slots returned by destroy()
+    std::size_t next_block = first_block;
+
+    void grow() {
+        blocks.push_back(std::make_unique<Slot[]>(next_block));
+        cursor = blocks.back().get();
+        block_end = cursor + next_block;
+        if (next_block < max_block) next_block *= 2;
+    }
+
+    void take(NodePool& other) noexcept {
+        blocks = std::move(other.blocks);
+        cursor = std::exchange(other.cursor, nullptr);
+        block_end = std::exchange(other.block_end, nullptr);
+        free_list = std::exchange(other.free_list, nullptr);
+        next_block = std::exchange(other.next_block, first_block);
+    }
+
+public:
+    // release() frees all nodes without visiting them
+    static constexpr bool releases_in_bulk = true;
+
+    NodePool() = default;
+    ~NodePool() = default;
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+    NodePool(NodePool&& other) noexcept { take(other); }
+    NodePool& operator=(NodePool&& other) noexcept {
+        if (this != &other) take(other);
+        return *this;
+    }
+
+    // Construct a node in a recycled slot, or in the next slot of the current block
+    template<typename... Args>
+    NodeT* create(Args&&... args) {
+        tree_counters::count_allocations();
+        Slot* slot;
+        if (free_list != nullptr) {
+            slot = free_list;
+            free_list = slot->next;
+        } else {
+            if (cursor == block_end) grow();
+            slot = cursor++;
+        }
+        try {
+            return ::new (static_cast<void*>(slot->storage)) NodeT(std::forward<Args>(args)...);
+        } catch (...) {
+            slot->next = free_list;
+            free_list = slot;
+            throw;
+        }
+    }
+
+    // Destroy a single node and put its slot on the free list
+    void destroy(NodeT* node) noexcept {
+        node->~NodeT();
+        Slot* slot = reinterpret_cast<Slot*>(node);
+        slot->next = free_list;
+        free_list = slot;
+    }
+
+    // Drop every block. Destructors of live nodes are not run here: the owner must
+    // have destroyed them already if NodeT is not trivially destructible.
+    void release() noexcept {
+        blocks.clear();
+        cursor = block_end = free_list = nullptr;
+        next_block = first_block;
+    }
+};
+
+// Plain new/delete allocator, one heap allocation per node
+template<typename NodeT>
+class HeapNodeAllocator {
+public:
+    // Nodes must be destroyed one by one
+    static constexpr bool releases_in_bulk = false;
+
+    template<typename... Args>
+    NodeT* create(Args&&... args) {
+        tree_counters::count_allocations();
+        return new NodeT(std::forward<Args>(args)...);
+    }
+
+    void destroy(NodeT* node) noexcept {
+        delete node;
+    }
+
+    void release() noexcept {}
+};
+
+#endif //NODE_POOL_H
@@ -0,0 +1,472 @@
+//
+// Persistent (copy-on-write) tree: O(1) copies that share structure, path-copying updates
+//
+
+#ifndef PERSISTENT_TREE_H
+#define PERSISTENT_TREE_H
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "binary_tree.h"
+#include "lookup_key.h"
+#include "node_pool.h"
+#include "tree_counters.h"
+
+// Immutable once linked; refs counts the parents and tree versions pointing at the node
+template<typename T>
+struct PersistentNode {
+    T data;
+    const PersistentNode* left;
+    const PersistentNode* right;
+    int height;
+    int count;
+    int size;
+    mutable int refs = 0;
+
+    PersistentNode(T value, const int copies, const PersistentNode* l, const PersistentNode* r)
+        : data(std::move(value)), left(l), right(r),
+          height(1 + std::max(l ? l->height : -1, r ? r->height : -1)),
+          count(copies), size(copies + (l ? l->size : 0) + (r ? r->size : 0)) {}
+};
+
+// Tree whose versions share structure. Copying a tree is O(1): the copy points at the same
+// root and both versions share every node. An insertion never modifies a node; it copies
+// the O(height) nodes on the path to the insertion point (rebalancing the copies in AVL
+// mode) and links them to the untouched subtrees. Nodes are reference counted, so a node
+// returns to the pool shared by all versions as soon as the last version using it is gone.
+//
+// Reference counts are not atomic: versions of one tree must stay on one thread.
+template<typename T>
+class PersistentTree {
+public:
+    using NodeType = PersistentNode<T>;
+    using Key = lookup_key_t<T>;
+
+private:
+    std::shared_ptr<NodePool<NodeType>> pool;
+    const NodeType* root = nullptr;
+    BalanceMode balance;
+    DuplicateMode duplicates;
+    // Scratch space of insert_version and release, reused between updates
+    std::vector<std::pair<const NodeType*, bool>> insert_path;
+    std::vector<const NodeType*> release_stack;
+    std::vector<const NodeType*> join_spine;
+
+    static int height_of(const NodeType* node) { return node ? node->height : -1; }
+    static int size_of(const NodeType* node) { return node ? node->size : 0; }
+
+    static void acquire(const NodeType* node) {
+        if (node) ++node->refs;
+    }
+
+    // Drop one reference; nodes nobody points at any more are freed along with the
+    // references they hold
+    void release(const NodeType* node) {
+        release_stack.assign(1, node);
+        while (!release_stack.empty()) {
+            const NodeType* current = release_stack.back();
+            release_stack.pop_back();
+            if (current == nullptr || --current->refs > 0) continue;
+            release_stack.push_back(current->left);
+            release_stack.push_back(current->right);
+            pool->destroy(const_cast<NodeType*>(current));
+        }
+    }
+
+    // Free a node built during this update that a rotation left unlinked
+    void discard(const NodeType* node) {
+        if (node->refs != 0) return;
+        ++node->refs;
+        release(node);
+    }
+
+    const NodeType* make(T data, const int count, const NodeType* left, const NodeType* right) {
+        acquire(left);
+        acquire(right);
+        return pool->create(std::move(data), count, left, right);
+    }
+
+    // New node with the given contents whose children differ in height by at most two,
+    // rotated back into AVL shape in AVL mode
+    const NodeType* balanced(const T& data, const int count, const NodeType* left, const NodeType* right) {
+        if (balance == BalanceMode::AVL && height_of(left) > height_of(right) + 1) {
+            const NodeType* result;
+            if (height_of(left->left) >= height_of(left->right)) {
+                result = make(left->data, left->count, left->left, make(data, count, left->right, right));
+            } else {
+                const NodeType* pivot = left->right;
+                result = make(pivot->data, pivot->count,
+                              make(left->data, left->count, left->left, pivot->left),
+                              make(data, count, pivot->right, right));
+            }
+            discard(left);
+            return result;
+        }
+        if (balance == BalanceMode::AVL && height_of(right) > height_of(left) + 1) {
+            const NodeType* result;
+            if (height_of(right->right) >= height_of(right->left)) {
+                result = make(right->data, right->count, make(data, count, left, right->left), right->right);
+            } else {
+                const NodeType* pivot = right->left;
+                result = make(pivot->data, pivot->count,
+                              make(data, count, left, pivot->left),
+                              make(right->data, right->count, pivot->right, right->right));
+            }
+            discard(right);
+            return result;
+        }
+        return make(data, count, left, right);
+    }
+
+    // Root of the version with value inserted, or current when nothing changes. Repeated
+    // values go left in chain mode and bump the node multiplicity in counted mode.
+    const NodeType* insert_version(const NodeType* current, const T& value, const bool repeat) {
+        const bool chain = repeat && duplicates == DuplicateMode::Chain;
+        insert_path.clear();
+        const NodeType* replacement = nullptr;
+        for (const NodeType* node = current; node != nullptr; ) {
+            if (chain ? !(node->data < value) : value < node->data) {
+                insert_path.emplace_back(node, true);
+                node = node->left;
+            } else if (chain || node->data < value) {
+                insert_path.emplace_back(node, false);
+                node = node->right;
+            } else {
+                tree_counters::count_visits(insert_path.size() + 1);
+                if (!repeat) return current;
+                replacement = make(node->data, node->count + 1, node->left, node->right);
+                break;
+            }
+        }
+        if (replacement == nullptr) {
+            tree_counters::count_visits(insert_path.size());
+            replacement = make(value, 1, nullptr, nullptr);
+        }
+
+        // Copy the path bottom-up, rebalancing each copy
+        for (auto it = insert_path.rbegin(); it != insert_path.rend(); ++it) {
+            const auto [node, went_left] = *it;
+            replacement = went_left ? balanced(node->data, node->count, replacement, node->right)
+                                    : balanced(node->data, node->count, node->left, replacement);
+        }
+        return replacement;
+    }
+
+    // Root of the version without a node equal to value (without one of its copies in
+    // counted mode unless all is set), or current when value is absent. Like an insertion
+    // this copies the search path; a node with two children is replaced by a copy of the
+    // smallest node of its right subtree, whose own path is copied as well.
+    const NodeType* erase_version(const NodeType* current, Key value, const bool all, int& removed) {
+        insert_path.clear();
+        const NodeType* target = current;
+        while (target != nullptr) {
+            const bool go_left = value < target->data;
+            if (!go_left & !(target->data < value)) break;
+            insert_path.emplace_back(target, go_left);
+            target = go_left ? target->left : target->right;
+        }
+        tree_counters::count_visits(insert_path.size() + (target != nullptr));
+        removed = 0;
+        if (target == nullptr) return current;
+
+        const std::size_t above = insert_path.size();
+        const NodeType* replacement;
+        removed = !all && target->count > 1 ? 1 : target->count;
+        if (removed < target->count) {
+            replacement = make(target->data, target->count - removed, target->left, target->right);
+        } else if (target->left == nullptr || target->right == nullptr) {
+            replacement = target->left != nullptr ? target->left : target->right;
+        } else {
+            const NodeType* successor = target->right;
+            while (successor->left != nullptr) {
+                insert_path.emplace_back(successor, true);
+                successor = successor->left;
+            }
+            tree_counters::count_visits(insert_path.size() - above + 1);
+            // Right subtree of target without its smallest node, copied bottom-up
+            const NodeType* right = successor->right;
+            while (insert_path.size() > above) {
+                const NodeType* node = insert_path.back().first;
+                insert_path.pop_back();
+                right = balanced(node->data, node->count, right, node->right);
+            }
+            replacement = balanced(successor->data, successor->count, target->left, right);
+        }
+
+        for (auto it = insert_path.rbegin(); it != insert_path.rend(); ++it) {
+            const auto [node, went_left] = *it;
+            replacement = went_left ? balanced(node->data, node->count, replacement, node->right)
+                                    : balanced(node->data, node->count, node->left, replacement);
+        }
+        return replacement;
+    }
+
+    // Tree holding left, a copy of data and right in that order, like BinaryTree::join. In
+    // AVL mode the spine of the taller side is copied down to where the heights meet, so
+    // this creates O(|height(left) - height(right)| + 1) nodes. Replaced spine nodes built
+    // during this update are freed.
+    const NodeType* join(const NodeType* left, const T& data, const int count, const NodeType* right) {
+        const int left_height = height_of(left);
+        const int right_height = height_of(right);
+        if (balance != BalanceMode::AVL || std::abs(left_height - right_height) <= 1) return make(data, count, left, right);
+        const bool left_taller = left_height > right_height;
+        const NodeType* taller = left_taller ? left : right;
+        const int lower_height = left_taller ? right_height : left_height;
+        join_spine.clear();
+        const NodeType* node = taller;
+        while (height_of(node) > lower_height + 1) {
+            join_spine.push_back(node);
+            node = left_taller ? node->right : node->left;
+        }
+        const NodeType* result = left_taller ? make(data, count, node, right) : make(data, count, left, node);
+        for (auto it = join_spine.rbegin(); it != join_spine.rend(); ++it) {
+            const NodeType* spine = *it;
+            result = left_taller ? balanced(spine->data, spine->count, spine->left, result)
+                                 : balanced(spine->data, spine->count, result, spine->right);
+        }
+        discard(taller);
+        return result;
+    }
+
+    // Tree holding left and then right; a copy of the smallest node of right joins them
+    const NodeType* join(const NodeType* left, const NodeType* right) {
+        if (left == nullptr) return right;
+        if (right == nullptr) return left;
+        join_spine.clear();
+        const NodeType* smallest = right;
+        while (smallest->left != nullptr) {
+            join_spine.push_back(smallest);
+            smallest = smallest->left;
+        }
+        const NodeType* rest = smallest->right;
+        for (auto it = join_spine.rbegin(); it != join_spine.rend(); ++it) {
+            rest = balanced((*it)->data, (*it)->count, rest, (*it)->right);
+        }
+        const NodeType* result = join(left, smallest->data, smallest->count, rest);
+        discard(right);
+        return result;
+    }
+
+    // The values of tree below value, or above it when above is set. The nodes kept on the
+    // search path are joined back bottom-up; the join costs telescope, so the split creates
+    // O(height) nodes and shares everything else with tree.
+    const NodeType* split_side(const NodeType* tree, Key value, const bool above) {
+        insert_path.clear();
+        std::uint64_t visits = 0;
+        for (const NodeType* node = tree; node != nullptr; ++visits) {
+            const bool keep = above ? value < node->data : node->data < value;
+            if (keep) insert_path.emplace_back(node, above);
+            node = keep == above ? node->left : node->right;
+        }
+        tree_counters::count_visits(visits);
+        const NodeType* result = nullptr;
+        for (auto it = insert_path.rbegin(); it != insert_path.rend(); ++it) {
+            const NodeType* node = it->first;
+            result = above ? join(result, node->data, node->count, node->right)
+                           : join(node->left, node->data, node->count, result);
+        }
+        return result;
+    }
+
+    // Make next the current version; nodes only the previous one used are freed
+    void publish(const NodeType* next) {
+        acquire(next);
+        const NodeType* previous = std::exchange(root, next);
+        release(previous);
+    }
+
+    // Print every value of the subtree in the given order, copies repeated
+    template<TraversalOrder Order>
+    void print_order(std::ostream& out) const {
+        std::vector<std::pair<const NodeType*, bool>> stack;
+        if (root) stack.emplace_back(root, false);
+        std::uint64_t visits = 0;
+        while (!stack.empty()) {
+            const auto [node, expanded] = stack.back();
+            stack.pop_back();
+            if (expanded) {
+                for (int i = 0; i < node->count; ++i) out << node->data << " ";
+                continue;
+            }
+            ++visits;
+            // Pushed in reverse: whatever is on top comes out first
+            if constexpr (Order == TraversalOrder::Postorder) stack.emplace_back(node, true);
+            if (node->right) stack.emplace_back(node->right, false);
+            if constexpr (Order == TraversalOrder::Inorder) stack.emplace_back(node, true);
+            if (node->left) stack.emplace_back(node->left, false);
+            if constexpr (Order == TraversalOrder::Preorder) stack.emplace_back(node, true);
+        }
+        out << std::endl;
+        tree_counters::count_visits(visits);
+    }
+
+public:
+    explicit PersistentTree(const BalanceMode mode = BalanceMode::None,
+                            const DuplicateMode duplicate_mode = DuplicateMode::Chain)
+        : pool(std::make_shared<NodePool<NodeType>>()), balance(mode), duplicates(duplicate_mode) {}
+
+    ~PersistentTree() {
+        if (root) release(root);
+    }
+
+    // O(1): the copy shares every node with other
+    PersistentTree(const PersistentTree& other)
+        : pool(other.pool), root(other.root), balance(other.balance), duplicates(other.duplicates) {
+        acquire(root);
+    }
+
+    PersistentTree(PersistentTree&& other) noexcept
+        : pool(other.pool), root(std::exchange(other.root, nullptr)), balance(other.balance),
+          duplicates(other.duplicates) {}
+
+    PersistentTree& operator=(PersistentTree other) noexcept {
+        std::swap(pool, other.pool);
+        std::swap(root, other.root);
+        std::swap(balance, other.balance);
+        std::swap(duplicates, other.duplicates);
+        return *this;
+    }
+
+    // Another version sharing this one's nodes, in O(1)
+    [[nodiscard]] PersistentTree clone() const { return *this; }
+
+    [[nodiscard]] BalanceMode get_balance() const { return balance; }
+    [[nodiscard]] DuplicateMode get_duplicates() const { return duplicates; }
+    const NodeType* get_root() const { return root; }
+
+    // Insert value, copying the O(height) nodes on its path
+    void insert_node(const T& value, const bool repeat) {
+        const NodeType* next = insert_version(root, value, repeat);
+        if (next != root) publish(next);
+    }
+
+    // Insert a batch one value at a time; nodes of the intermediate versions are freed as
+    // soon as the next value replaces them
+    void insert_many(const std::vector<T>& values, const bool repeat) {
+        for (const T& value : values) insert_node(value, repeat);
+    }
+
+    // Remove one copy of value; returns whether it was present. The nodes only the previous
+    // version used go back to the pool right away.
+    bool erase(Key value) {
+        int removed;
+        const NodeType* next = erase_version(root, value, false, removed);
+        if (removed != 0) publish(next);
+        return removed != 0;
+    }
+
+    // Remove every copy of value as one new version in O(height); returns how many were
+    // removed. The values below and above value are split off with path copying and joined,
+    // so a run of chained copies is dropped as a whole.
+    int erase_all(Key value) {
+        if (!search(value)) return 0;
+        const NodeType* below = split_side(root, value, false);
+        const NodeType* above = split_side(root, value, true);
+        const NodeType* next = join(below, above);
+        const int removed = size() - size_of(next);
+        publish(next);
+        return removed;
+    }
+
+    void clear() noexcept {
+        if (root) release(std::exchange(root, nullptr));
+    }
+
+    bool search(Key value) const {
+        std::uint64_t visits = 0;
+        const NodeType* node = root;
+        for (; node != nullptr; ++visits) {
+            const bool go_left = value < node->data;
+            if (!go_left & !(node->data < value)) break;
+            node = go_left ? node->left : node->right;
+        }
+        tree_counters::count_visits(visits + (node != nullptr));
+        return node != nullptr;
+    }
+
+    // Copies of value and their min/max level; equal keys can sit on both sides of each
+    // other after rotations, so both children of a match are explored
+    EntryStats count(Key value) const {
+        EntryStats stats;
+        std::vector<std::pair<const NodeType*, int>> stack;
+        if (root) stack.emplace_back(root, 0);
+        std::uint64_t visits = 0;
+        while (!stack.empty()) {
+            const auto [node, level] = stack.back();
+            stack.pop_back();
+            ++visits;
+            const bool go_left = !(node->data < value);
+            const bool go_right = !(value < node->data);
+            if (go_left && go_right) {
+                stats.count += node->count;
+                stats.min_level = std::min(stats.min_level, level);
+                stats.max_level = std::max(stats.max_level, level);
+            }
+            if (go_right && node->right) stack.emplace_back(node->right, level + 1);
+            if (go_left && node->left) stack.emplace_back(node->left, level + 1);
+        }
+        tree_counters::count_visits(visits);
+        return stats;
+    }
+
+    int count_entries(Key value, std::ostream& out = std::cout) const {
+        const EntryStats stats = count(value);
+        out << "Min level: " << stats.min_level << std::endl;
+        out << "Max level: " << stats.max_level << std::endl;
+        return stats.count;
+    }
+
+    void inorder(std::ostream& out = std::cout) const { print_order<TraversalOrder::Inorder>(out); }
+    void preorder(std::ostream& out = std::cout) const { print_order<TraversalOrder::Preorder>(out); }
+    void postorder(std::ostream& out = std::cout) const { print_order<TraversalOrder::Postorder>(out); }
+
+    // Print the tree sideways: right subtree above its parent
+    void print_tree(std::ostream& out = std::cout) const {
+        std::vector<std::pair<const NodeType*, int>> stack;
+        const NodeType* node = root;
+        int level = 0;
+        while (node != nullptr || !stack.empty()) {
+            while (node != nullptr) {
+                stack.emplace_back(node, level++);
+                node = node->right;
+            }
+            const auto [current, current_level] = stack.back();
+            stack.pop_back();
+            for (int i = 0; i < current_level; i++) out << "   ";
+            out << current->data;
+            if (current->count > 1) out << " (x" << current->count << ")";
+            out << std::endl;
+            node = current->left;
+            level = current_level + 1;
+        }
+    }
+
+    [[nodiscard]] int height() const { return height_of(root); }
+
+    void find_levels(std::ostream& out = std::cout) const {
+        out << "Min level: 0" << std::endl;
+        out << "Max level: " << height() << std::endl;
+    }
+
+    [[nodiscard]] bool empty() const { return root == nullptr; }
+    [[nodiscard]] int size() const { return size_of(root); }
+
+    // Smallest and largest stored value (T{} when empty), in O(height)
+    T min() const {
+        const NodeType* node = root;
+        while (node && node->left) node = node->left;
+        return node ? node->data : T{};
+    }
+
+    T max() const {
+        const NodeType* node = root;
+        while (node && node->right) node = node->right;
+        return node ? node->data : T{};
+    }
+};
+
+#endif //PERSISTENT_TREE_H
@@ -0,0 +1,300 @@
+//
+// Binary snapshot files for BinaryTree: compact preorder image, reloaded through mmap
+//
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "binary_tree.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// File layout (native byte order):
+//   header  magic "BTSNAP01", value kind (u8), value size (u8, 0 for strings), balance (u8), duplicates (u8),
+//           4 reserved bytes, node count (u64)
+//   nodes   in preorder: flags (u8: bit 0 has left child, bit 1 has right child),
+//           count (u32), value (raw bytes, or u32 length + bytes for std::string)
+// Heights and sizes are not stored; loading recomputes them.
+namespace snapshot_detail {
+    constexpr char magic[8] = {'B', 'T', 'S', 'N', 'A', 'P', '0', '1'};
+    constexpr std::uint8_t has_left = 1;
+    constexpr std::uint8_t has_right = 2;
+
+    struct Header {
+        char magic[8];
+        std::uint8_t kind;
+        std::uint8_t value_size;
+        std::uint8_t balance;
+        std::uint8_t duplicates;
+        std::uint8_t reserved[4];
+        std::uint64_t nodes;
+    };
+    static_assert(sizeof(Header) == 24);
+
+    // Identifies the value type so a file is not read back as a different one
+    template<typename T>
+    constexpr std::uint8_t value_kind() {
+        if constexpr (std::is_same_v<T, std::string>) return 0;
+        else if constexpr (std::is_same_v<T, char>) return 1;
+        else if constexpr (std::is_integral_v<T>) return std::is_signed_v<T> ? 2 : 3;
+        else if constexpr (std::is_floating_point_v<T>) return 4;
+        else static_assert(std::is_trivially_copyable_v<T>, "Snapshot values must be strings or trivially copyable");
+        return 5;
+    }
+
+    // Stored size of one value; strings are variable length and record 0
+    template<typename T>
+    constexpr std::uint8_t value_size() {
+        if constexpr (std::is_same_v<T, std::string>) return 0;
+        else return static_cast<std::uint8_t>(sizeof(T));
+    }
+
+    // Bytes of the shortest node record: flags, count and an empty string or a raw value
+    template<typename T>
+    constexpr std::size_t min_record_size() {
+        return sizeof(std::uint8_t) + sizeof(std::uint32_t) +
+               (std::is_same_v<T, std::string> ? sizeof(std::uint32_t) : sizeof(T));
+    }
+
+    template<typename T>
+    void append_raw(std::string& out, const T& value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    void append_value(std::string& out, const T& value) {
+        if constexpr (std::is_same_v<T, std::string>) {
+            append_raw(out, static_cast<std::uint32_t>(value.size()));
+            out.append(value);
+        } else {
+            append_raw(out, value);
+        }
+    }
+
+    // Bounds-checked cursor over the mapped file
+    class Reader {
+    private:
+        const char* pos;
+        const char* end;
+
+    public:
+        Reader(const char* begin, const std::size_t size) : pos(begin), end(begin + size) {}
+
+        void read(void* target, const std::size_t bytes) {
+            if (static_cast<std::size_t>(end - pos) < bytes) throw std::runtime_error("Snapshot is truncated");
+            std::memcpy(target, pos, bytes);
+            pos += bytes;
+        }
+
+        template<typename T>
+        T read() {
+            T value;
+            read(&value, sizeof(T));
+            return value;
+        }
+
+        template<typename T>
+        void read_value(T& value) {
+            if constexpr (std::is_same_v<T, std::string>) {
+                const auto length = read<std::uint32_t>();
+                if (static_cast<std::size_t>(end - pos) < length) throw std::runtime_error("Snapshot is truncated");
+                value.assign(pos, length);
+                pos += length;
+            } else {
+                read(&value, sizeof(T));
+            }
+        }
+
+        [[nodiscard]] bool at_end() const { return pos == end; }
+        [[nodiscard]] std::size_t remaining() const { return static_cast<std::size_t>(end - pos); }
+    };
+
+    // Read-only mapping of a whole file, unmapped on destruction
+    class MappedFile {
+    private:
+        const char* data_ = nullptr;
+        std::size_t size_ = 0;
+#ifdef _WIN32
+        HANDLE file_ = INVALID_HANDLE_VALUE;
+        HANDLE mapping_ = nullptr;
+#endif
+
+    public:
+        explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+            file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file_ == INVALID_HANDLE_VALUE) throw std::runtime_error("Cannot open file '" + path + "'");
+            LARGE_INTEGER size;
+            GetFileSizeEx(file_, &size);
+            size_ = static_cast<std::size_t>(size.QuadPart);
+            if (size_ == 0) return;
+            mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping_ == nullptr) {
+                CloseHandle(file_);
+                throw std::runtime_error("Cannot map file '" + path + "'");
+            }
+            data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+            if (data_ == nullptr) {
+                CloseHandle(mapping_);
+                CloseHandle(file_);
+                throw std::runtime_error("Cannot map file '" + path + "'");
+            }
+#else
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) throw std::runtime_error("Cannot open file '" + path + "'");
+            struct stat info {};
+            if (::fstat(fd, &info) != 0) {
+                ::close(fd);
+                throw std::runtime_error("Cannot read file '" + path + "'");
+            }
+            size_ = static_cast<std::size_t>(info.st_size);
+            if (size_ != 0) {
+                void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped == MAP_FAILED) {
+                    ::close(fd);
+                    throw std::runtime_error("Cannot map file '" + path + "'");
+                }
+                // The image is read front to back exactly once
+                ::madvise(mapped, size_, MADV_SEQUENTIAL);
+                data_ = static_cast<const char*>(mapped);
+            }
+            ::close(fd);
+#endif
+        }
+
+        ~MappedFile() {
+#ifdef _WIN32
+            if (data_) UnmapViewOfFile(data_);
+            if (mapping_) CloseHandle(mapping_);
+            if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+            if (data_) ::munmap(const_cast<char*>(data_), size_);
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        [[nodiscard]] const char* data() const { return data_; }
+        [[nodiscard]] std::size_t size() const { return size_; }
+    };
+}
+
+// Write tree to path as a binary snapshot (set trees only)
+template<typename T, typename Compare, template<typename> class Allocator>
+void save_snapshot(const BinaryTree<T, void, Compare, Allocator>& tree, const std::string& path) {
+    using namespace snapshot_detail;
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) throw std::runtime_error("Cannot open file '" + path + "' for writing");
+
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.kind = value_kind<T>();
+    header.value_size = value_size<T>();
+    header.balance = static_cast<std::uint8_t>(tree.get_balance());
+    header.duplicates = static_cast<std::uint8_t>(tree.get_duplicates());
+
+    // Records are staged in a buffer and written in large chunks
+    constexpr std::size_t chunk = 1 << 20;
+    std::string buffer;
+    buffer.reserve(chunk + 64);
+    append_raw(buffer, header);
+    std::vector<const Node<T>*> stack;
+    if (tree.get_root()) stack.push_back(tree.get_root());
+    while (!stack.empty()) {
+        const Node<T>* node = stack.back();
+        stack.pop_back();
+        ++header.nodes;
+        const std::uint8_t flags = (node->left ? has_left : 0) | (node->right ? has_right : 0);
+        append_raw(buffer, flags);
+        append_raw(buffer, static_cast<std::uint32_t>(node->count));
+        append_value(buffer, node->data);
+        if (node->right) stack.push_back(node->right);
+        if (node->left) stack.push_back(node->left);
+        if (buffer.size() >= chunk) {
+            file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    }
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    // The node count is known only now; patch it into the header
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!file.flush()) throw std::runtime_error("Failed to write '" + path + "'");
+}
+
+// Map a snapshot written by save_snapshot and rebuild the tree in one sequential pass,
+// keeping its shape and its balance/duplicate modes
+template<typename T, typename Compare = std::less<>, template<typename> class Allocator = NodePool>
+BinaryTree<T, void, Compare, Allocator> load_snapshot(const std::string& path) {
+    using namespace snapshot_detail;
+    const MappedFile mapped(path);
+    Reader reader(mapped.data(), mapped.size());
+
+    const auto header = reader.read<Header>();
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0) throw std::runtime_error("'" + path + "' is not a tree snapshot");
+    if (header.kind != value_kind<T>() || header.value_size != value_size<T>()) {
+        throw std::runtime_error("Snapshot '" + path + "' holds a different value type");
+    }
+    if (header.balance > static_cast<std::uint8_t>(BalanceMode::AVL) ||
+        header.duplicates > static_cast<std::uint8_t>(DuplicateMode::Counted)) {
+        throw std::runtime_error("Snapshot '" + path + "' is corrupt");
+    }
+    // Checked before anything is reserved for the nodes: a damaged count must not allocate
+    if (header.nodes > reader.remaining() / min_record_size<T>()) {
+        throw std::runtime_error("Snapshot '" + path + "' is corrupt: node count exceeds the file size");
+    }
+
+    const auto duplicates = static_cast<DuplicateMode>(header.duplicates);
+    BinaryTree<T, void, Compare, Allocator> tree(static_cast<BalanceMode>(header.balance), duplicates);
+    // Every node must fit between the nodes above it: strictly in counted mode, where keys
+    // are distinct, and inclusively in chain mode, where rotations can leave equal copies
+    // on either side. Bounds are pushed in the order assign_preorder fills the links.
+    struct Bounds { const T* lo; const T* hi; };
+    std::vector<Bounds> bounds;
+    if (header.nodes != 0) bounds.push_back({nullptr, nullptr});
+    const Compare compare{};
+    const bool strict = duplicates == DuplicateMode::Counted;
+    std::uint64_t total = 0;
+    tree.assign_preorder(static_cast<std::size_t>(header.nodes), [&](Node<T>& node) {
+        const auto flags = reader.read<std::uint8_t>();
+        const auto count = reader.read<std::uint32_t>();
+        if (count == 0 || (!strict && count != 1)) throw std::runtime_error("Snapshot is corrupt: bad copy count");
+        // Subtree sizes are int, so the whole tree has to fit in one
+        total += count;
+        if (total > INT_MAX) throw std::runtime_error("Snapshot is corrupt: too many values");
+        node.count = static_cast<int>(count);
+        reader.read_value(node.data);
+
+        const Bounds range = bounds.back();
+        bounds.pop_back();
+        const bool above_lo = range.lo == nullptr || (strict ? compare(*range.lo, node.data) : !compare(node.data, *range.lo));
+        const bool below_hi = range.hi == nullptr || (strict ? compare(node.data, *range.hi) : !compare(*range.hi, node.data));
+        if (!above_lo || !below_hi) throw std::runtime_error("Snapshot is corrupt: values are out of order");
+        const bool has_left_child = (flags & has_left) != 0;
+        const bool has_right_child = (flags & has_right) != 0;
+        if (has_right_child) bounds.push_back({&node.data, range.hi});
+        if (has_left_child) bounds.push_back({range.lo, &node.data});
+        return std::pair<bool, bool>{has_left_child, has_right_child};
+    });
+    if (!reader.at_end()) throw std::runtime_error("Snapshot '" + path + "' has trailing data");
+    return tree;
+}
+
+#endif //SNAPSHOT_H
@@ -0,0 +1,168 @@
+//
+// Work-stealing thread pool for fork-join tree queries
+//
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Each worker owns a deque: it pushes and pops its own tasks at the back (newest, still
+// hot in cache) and, when idle, steals the oldest task from the front of another deque.
+// Oldest tasks are the biggest subtrees in a fork-join walk, so one steal moves a lot of work.
+class WorkStealingPool {
+private:
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<std::size_t> queued{0};      // Tasks waiting in any deque
+    std::atomic<std::size_t> next_queue{0};  // Round-robin target for tasks from outside the pool
+    std::atomic<bool> stopping{false};
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+
+    // Pool and deque index of the calling thread, if it is one of our workers
+    static WorkStealingPool*& current_pool() {
+        thread_local WorkStealingPool* pool = nullptr;
+        return pool;
+    }
+    static std::size_t& current_index() {
+        thread_local std::size_t index = 0;
+        return index;
+    }
+
+    bool pop_back(Queue& queue, std::function<void()>& task) {
+        std::lock_guard lock(queue.mutex);
+        if (queue.tasks.empty()) return false;
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool steal_front(Queue& queue, std::function<void()>& task) {
+        std::lock_guard lock(queue.mutex);
+        if (queue.tasks.empty()) return false;
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    }
+
+    void worker_loop(const std::size_t index) {
+        current_pool() = this;
+        current_index() = index;
+        while (true) {
+            if (run_pending()) continue;
+            std::unique_lock lock(sleep_mutex);
+            wake.wait(lock, [this] { return stopping.load() || queued.load() > 0; });
+            if (stopping.load() && queued.load() == 0) return;
+        }
+    }
+
+public:
+    // threads workers; the thread waiting on a TaskGroup also executes tasks
+    explicit WorkStealingPool(const std::size_t threads) {
+        const std::size_t count = std::max<std::size_t>(threads, 1);
+        for (std::size_t i = 0; i < count; ++i) queues.push_back(std::make_unique<Queue>());
+        for (std::size_t i = 0; i < count; ++i) workers.emplace_back(&WorkStealingPool::worker_loop, this, i);
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard lock(sleep_mutex);
+            stopping.store(true);
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    [[nodiscard]] std::size_t size() const { return workers.size(); }
+
+    // Queue a task on the calling worker's own deque, or spread it when called from outside
+    void submit(std::function<void()> task) {
+        const std::size_t index = current_pool() == this ? current_index()
+                                                         : next_queue.fetch_add(1) % queues.size();
+        {
+            std::lock_guard lock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        queued.fetch_add(1);
+        // Taking the lock orders this notify after any worker's predicate check
+        { std::lock_guard lock(sleep_mutex); }
+        wake.notify_one();
+    }
+
+    // Run one queued task on the calling thread: own deque first, then steal. Returns false if none.
+    bool run_pending() {
+        const bool is_worker = current_pool() == this;
+        const std::size_t self = is_worker ? current_index() : 0;
+        std::function<void()> task;
+        bool found = is_worker && pop_back(*queues[self], task);
+        for (std::size_t i = 1; !found && i <= queues.size(); ++i) {
+            found = steal_front(*queues[(self + i) % queues.size()], task);
+        }
+        if (!found) return false;
+        queued.fetch_sub(1);
+        task();
+        return true;
+    }
+};
+
+// Fork-join scope: run() forks tasks into the pool, wait() helps execute queued
+// work until all of them have finished and rethrows the first exception
+class TaskGroup {
+private:
+    WorkStealingPool& pool;
+    std::atomic<std::size_t> outstanding{0};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+public:
+    explicit TaskGroup(WorkStealingPool& owner) : pool(owner) {}
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+    ~TaskGroup() {
+        while (outstanding.load() != 0) {
+            if (!pool.run_pending()) std::this_thread::yield();
+        }
+    }
+
+    template<typename F>
+    void run(F&& f) {
+        outstanding.fetch_add(1);
+        pool.submit([this, task = std::forward<F>(f)]() mutable {
+            try {
+                task();
+            } catch (...) {
+                std::lock_guard lock(error_mutex);
+                if (!error) error = std::current_exception();
+            }
+            outstanding.fetch_sub(1);
+        });
+    }
+
+    void wait() {
+        while (outstanding.load() != 0) {
+            if (!pool.run_pending()) std::this_thread::yield();
+        }
+        if (error) std::rethrow_exception(std::exchange(error, nullptr));
+    }
+};
+
+#endif //THREAD_POOL_H
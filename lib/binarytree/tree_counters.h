@@ -0,0 +1,38 @@
+//
+// Process-wide operation counters (node visits, node allocations) for profiling
+//
+
+#ifndef TREE_COUNTERS_H
+#define TREE_COUNTERS_H
+#include <atomic>
+#include <cstdint>
+
+// Counting is off by default. Hot loops count in a local and publish once per operation,
+// so while it is off an operation pays a single relaxed load and a predictable branch.
+// Counters are atomic because pool workers publish from their own threads.
+namespace tree_counters {
+    inline std::atomic<bool> enabled{false};
+    inline std::atomic<std::uint64_t> node_visits{0};
+    inline std::atomic<std::uint64_t> allocations{0};
+
+    struct Totals {
+        std::uint64_t node_visits = 0;
+        std::uint64_t allocations = 0;
+    };
+
+    inline bool active() { return enabled.load(std::memory_order_relaxed); }
+
+    inline void count_visits(const std::uint64_t visits) {
+        if (active()) node_visits.fetch_add(visits, std::memory_order_relaxed);
+    }
+
+    inline void count_allocations(const std::uint64_t count = 1) {
+        if (active()) allocations.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    inline Totals totals() {
+        return {node_visits.load(std::memory_order_relaxed), allocations.load(std::memory_order_relaxed)};
+    }
+}
+
+#endif //TREE_COUNTERS_H
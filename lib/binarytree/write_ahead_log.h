@@ -0,0 +1,486 @@
+//
+// Append-only binary write-ahead log of BinaryTree mutations, with group commit and checkpoints
+//
+
+#ifndef WRITE_AHEAD_LOG_H
+#define WRITE_AHEAD_LOG_H
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "binary_tree.h"
+#include "snapshot.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// When appended records reach the disk
+enum class SyncPolicy : std::uint8_t {
+    EveryOp,  // fsync after every record; nothing acknowledged is ever lost
+    Group     // fsync once per group of records (or on commit()); a crash loses at most one group
+};
+
+namespace wal_detail {
+    constexpr char magic[8] = {'B', 'T', 'W', 'A', 'L', '0', '0', '1'};
+
+    // File header; the rest of the file is a sequence of framed records. generation names
+    // the checkpoint the records apply on top of.
+    struct Header {
+        char magic[8];
+        std::uint8_t kind;
+        std::uint8_t value_size;
+        std::uint8_t policy;
+        std::uint8_t reserved;
+        std::uint32_t generation;
+    };
+    static_assert(sizeof(Header) == 16);
+
+    // Record frame: payload length (u32), CRC-32 of the payload (u32), payload
+    constexpr std::size_t frame_size = 8;
+
+    inline std::uint32_t crc32(const char* data, const std::size_t size) {
+        static const auto table = [] {
+            std::array<std::uint32_t, 256> t{};
+            for (std::uint32_t i = 0; i < 256; ++i) {
+                std::uint32_t c = i;
+                for (int k = 0; k < 8; ++k) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[i] = c;
+            }
+            return t;
+        }();
+        std::uint32_t crc = 0xFFFFFFFFu;
+        for (std::size_t i = 0; i < size; ++i) crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    // Thin POSIX / Windows file layer: the log needs append, fsync and truncate
+    inline int open_log(const std::string& path) {
+#ifdef _WIN32
+        return ::_open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+        return ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+#endif
+    }
+
+    inline void write_all(const int fd, const char* data, std::size_t size) {
+        while (size > 0) {
+#ifdef _WIN32
+            const int written = ::_write(fd, data, static_cast<unsigned>(size));
+#else
+            const ssize_t written = ::write(fd, data, size);
+#endif
+            if (written <= 0) throw std::runtime_error("Write-ahead log write failed");
+            data += written;
+            size -= static_cast<std::size_t>(written);
+        }
+    }
+
+    inline void sync_file(const int fd) {
+#ifdef _WIN32
+        const int result = ::_commit(fd);
+#else
+        const int result = ::fsync(fd);
+#endif
+        if (result != 0) throw std::runtime_error("Write-ahead log fsync failed");
+    }
+
+    inline void truncate_file(const int fd, const std::uint64_t size) {
+#ifdef _WIN32
+        const bool ok = ::_chsize_s(fd, static_cast<long long>(size)) == 0;
+#else
+        const bool ok = ::ftruncate(fd, static_cast<off_t>(size)) == 0;
+#endif
+        if (!ok) throw std::runtime_error("Write-ahead log truncate failed");
+    }
+
+    inline void close_file(const int fd) {
+#ifdef _WIN32
+        ::_close(fd);
+#else
+        ::close(fd);
+#endif
+    }
+
+    // Make a file creation or rename in directory durable (no-op where unsupported)
+    inline void sync_directory([[maybe_unused]] const std::string& directory) {
+#ifndef _WIN32
+        const int fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        ::fsync(fd);
+        ::close(fd);
+#endif
+    }
+}
+
+// Log of insert, insertmany, erase and clear operations for one tree. Records are framed with a
+// length and CRC so a torn write at the tail is detected and cut off on replay.
+// Operations are logged before they are applied; with SyncPolicy::Group the caller
+// decides when a group ends by calling commit() (or lets group_size records accumulate).
+template<typename T>
+class WriteAheadLog {
+public:
+    enum class Op : std::uint8_t {
+        Insert = 1,      // repeat flag, one value
+        InsertMany = 2,  // repeat flag, value count (u32), values
+        Clear = 3,
+        Erase = 4,       // one value
+        EraseAll = 5     // one value
+    };
+
+    // Header fields of an existing log
+    struct Info {
+        std::uint32_t generation;
+        SyncPolicy policy;
+    };
+
+private:
+    std::string path_;
+    int fd_ = -1;
+    SyncPolicy policy_;
+    std::size_t group_size_;
+    std::size_t pending_records_ = 0;  // Records in buffer_ not yet written and synced
+    std::string buffer_;               // Framed records waiting for commit()
+    std::string payload_;              // Scratch space for the record being built
+
+    void append_record() {
+        snapshot_detail::append_raw(buffer_, static_cast<std::uint32_t>(payload_.size()));
+        snapshot_detail::append_raw(buffer_, wal_detail::crc32(payload_.data(), payload_.size()));
+        buffer_.append(payload_);
+        ++pending_records_;
+        if (policy_ == SyncPolicy::EveryOp || pending_records_ >= group_size_) commit();
+    }
+
+public:
+    static constexpr std::size_t default_group_size = 256;
+
+    // Open path for appending (created if missing); a new file needs reset() before use
+    explicit WriteAheadLog(std::string path, const SyncPolicy policy = SyncPolicy::Group,
+                           const std::size_t group_size = default_group_size)
+        : path_(std::move(path)), policy_(policy), group_size_(std::max<std::size_t>(group_size, 1)) {
+        fd_ = wal_detail::open_log(path_);
+        if (fd_ < 0) throw std::runtime_error("Cannot open write-ahead log '" + path_ + "'");
+    }
+
+    // Pending records are committed; errors at this point can only be dropped
+    ~WriteAheadLog() {
+        try {
+            commit();
+        } catch (...) {
+        }
+        if (fd_ >= 0) wal_detail::close_file(fd_);
+    }
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    [[nodiscard]] const std::string& path() const { return path_; }
+    [[nodiscard]] SyncPolicy policy() const { return policy_; }
+
+    void log_insert(const T& value, const bool repeat) {
+        payload_.clear();
+        snapshot_detail::append_raw(payload_, Op::Insert);
+        snapshot_detail::append_raw(payload_, static_cast<std::uint8_t>(repeat));
+        snapshot_detail::append_value(payload_, value);
+        append_record();
+    }
+
+    void log_insert_many(const std::vector<T>& values, const bool repeat) {
+        payload_.clear();
+        snapshot_detail::append_raw(payload_, Op::InsertMany);
+        snapshot_detail::append_raw(payload_, static_cast<std::uint8_t>(repeat));
+        snapshot_detail::append_raw(payload_, static_cast<std::uint32_t>(values.size()));
+        for (const T& value : values) snapshot_detail::append_value(payload_, value);
+        append_record();
+    }
+
+    // Removal of one copy of value, or of every copy when all is set
+    void log_erase(const T& value, const bool all) {
+        payload_.clear();
+        snapshot_detail::append_raw(payload_, all ? Op::EraseAll : Op::Erase);
+        snapshot_detail::append_value(payload_, value);
+        append_record();
+    }
+
+    void log_clear() {
+        payload_.clear();
+        snapshot_detail::append_raw(payload_, Op::Clear);
+        append_record();
+    }
+
+    // Write buffered records with a single write and make them durable with a single fsync
+    void commit() {
+        if (pending_records_ == 0) return;
+        wal_detail::write_all(fd_, buffer_.data(), buffer_.size());
+        wal_detail::sync_file(fd_);
+        buffer_.clear();
+        pending_records_ = 0;
+    }
+
+    // Drop every record and start over on top of checkpoint generation
+    void reset(const std::uint32_t generation) {
+        buffer_.clear();
+        pending_records_ = 0;
+        wal_detail::Header header{};
+        std::memcpy(header.magic, wal_detail::magic, sizeof(header.magic));
+        header.kind = snapshot_detail::value_kind<T>();
+        header.value_size = snapshot_detail::value_size<T>();
+        header.policy = static_cast<std::uint8_t>(policy_);
+        header.generation = generation;
+        wal_detail::truncate_file(fd_, 0);
+        wal_detail::write_all(fd_, reinterpret_cast<const char*>(&header), sizeof(header));
+        wal_detail::sync_file(fd_);
+    }
+
+    // Header of the log at path; empty when the file is missing or shorter than a header
+    // (a crash during reset())
+    static std::optional<Info> read_info(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        wal_detail::Header header{};
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return std::nullopt;
+        if (std::memcmp(header.magic, wal_detail::magic, sizeof(header.magic)) != 0) {
+            throw std::runtime_error("'" + path + "' is not a write-ahead log");
+        }
+        if (header.kind != snapshot_detail::value_kind<T>() || header.value_size != snapshot_detail::value_size<T>()) {
+            throw std::runtime_error("Write-ahead log '" + path + "' holds a different value type");
+        }
+        if (header.policy > static_cast<std::uint8_t>(SyncPolicy::Group)) throw std::runtime_error("Write-ahead log '" + path + "' is corrupt");
+        return Info{header.generation, static_cast<SyncPolicy>(header.policy)};
+    }
+
+    // Call apply(op, repeat, values) for every intact record of the log at path, in order.
+    // Reading stops at the first torn or corrupt record, and the file is cut back to the
+    // last intact one so new records are not appended after garbage. Returns the record count.
+    template<typename Apply>
+    static std::size_t replay(const std::string& path, Apply&& apply) {
+        std::uint64_t valid_size = sizeof(wal_detail::Header);
+        std::size_t records = 0;
+        {
+            const snapshot_detail::MappedFile mapped(path);
+            if (mapped.size() < valid_size) throw std::runtime_error("Write-ahead log '" + path + "' is truncated");
+            std::vector<T> values;
+            const char* data = mapped.data();
+            std::size_t offset = valid_size;
+            while (mapped.size() - offset >= wal_detail::frame_size) {
+                std::uint32_t length, crc;
+                std::memcpy(&length, data + offset, sizeof(length));
+                std::memcpy(&crc, data + offset + sizeof(length), sizeof(crc));
+                const std::size_t payload_start = offset + wal_detail::frame_size;
+                if (mapped.size() - payload_start < length) break;
+                if (wal_detail::crc32(data + payload_start, length) != crc) break;
+
+                snapshot_detail::Reader record(data + payload_start, length);
+                values.clear();
+                bool repeat = false;
+                Op op;
+                try {
+                    op = static_cast<Op>(record.read<std::uint8_t>());
+                    if (op == Op::Insert || op == Op::InsertMany) {
+                        repeat = record.read<std::uint8_t>() != 0;
+                        const std::uint32_t count = op == Op::Insert ? 1 : record.read<std::uint32_t>();
+                        if (count > length) break;
+                        values.resize(count);
+                        for (T& value : values) record.read_value(value);
+                    } else if (op == Op::Erase || op == Op::EraseAll) {
+                        record.read_value(values.emplace_back());
+                    } else if (op != Op::Clear) {
+                        break;
+                    }
+                    if (!record.at_end()) break;
+                } catch (const std::runtime_error&) {
+                    break;
+                }
+                apply(op, repeat, values);
+                ++records;
+                offset = payload_start + length;
+                valid_size = offset;
+            }
+            if (valid_size == mapped.size()) return records;
+        }
+        const int fd = wal_detail::open_log(path);
+        if (fd < 0) throw std::runtime_error("Cannot open write-ahead log '" + path + "'");
+        wal_detail::truncate_file(fd, valid_size);
+        wal_detail::sync_file(fd);
+        wal_detail::close_file(fd);
+        return records;
+    }
+};
+
+// Durable storage for one tree: checkpoints in <base>.<generation>.snap plus a log
+// (<base>.wal) of everything applied since the newest one.
+//
+// A checkpoint writes the next snapshot under a temporary name, renames it into place and
+// only then resets the log to the new generation. Recovery loads the newest snapshot and
+// replays the log only when the log belongs to that generation, so a crash at any step
+// neither loses acknowledged records nor applies them twice.
+template<typename T>
+class TreeJournal {
+private:
+    std::string base_;
+    std::uint32_t generation_;
+    WriteAheadLog<T> log_;
+
+    std::string snapshot_path(const std::uint32_t generation) const {
+        return base_ + "." + std::to_string(generation) + ".snap";
+    }
+
+    static std::string parent_directory(const std::string& base) {
+        const auto parent = std::filesystem::path(base).parent_path();
+        return parent.empty() ? "." : parent.string();
+    }
+
+    // base must be a valid name directly inside its directory, so its files cannot land
+    // anywhere list() does not look
+    static std::string checked_base(std::string base) {
+        if (!valid_name(std::filesystem::path(base).filename().string())) {
+            throw std::runtime_error("Invalid journal name '" + base + "' (letters, digits, '_' and '-' only)");
+        }
+        return base;
+    }
+
+    // Generations of the snapshots present for base, unordered
+    static std::vector<std::uint32_t> snapshot_generations(const std::string& base) {
+        std::vector<std::uint32_t> generations;
+        const std::string prefix = std::filesystem::path(base).filename().string() + ".";
+        for (const auto& entry : std::filesystem::directory_iterator(parent_directory(base))) {
+            const std::string file = entry.path().filename().string();
+            if (file.size() <= prefix.size() + 5 || file.compare(0, prefix.size(), prefix) != 0 ||
+                !file.ends_with(".snap")) continue;
+            const std::string digits = file.substr(prefix.size(), file.size() - prefix.size() - 5);
+            if (digits.empty() || !std::all_of(digits.begin(), digits.end(), [](const char c) { return c >= '0' && c <= '9'; })) continue;
+            generations.push_back(static_cast<std::uint32_t>(std::stoul(digits)));
+        }
+        return generations;
+    }
+
+    void write_snapshot(const BinaryTree<T>& tree, const std::uint32_t generation) const {
+        const std::string target = snapshot_path(generation);
+        const std::string temporary = target + ".tmp";
+        save_snapshot(tree, temporary);
+        {
+            // save_snapshot flushes the stream; the data also has to reach the disk before the rename
+            const int fd = wal_detail::open_log(temporary);
+            if (fd < 0) throw std::runtime_error("Cannot open '" + temporary + "'");
+            wal_detail::sync_file(fd);
+            wal_detail::close_file(fd);
+        }
+        std::filesystem::rename(temporary, target);
+        wal_detail::sync_directory(parent_directory(base_));
+    }
+
+    // Delete every snapshot of base except keep (0 keeps none)
+    static void remove_snapshots(const std::string& base, const std::uint32_t keep) {
+        for (const std::uint32_t generation : snapshot_generations(base)) {
+            if (generation == keep) continue;
+            std::filesystem::remove(base + "." + std::to_string(generation) + ".snap");
+        }
+    }
+
+    TreeJournal(std::string base, const std::uint32_t generation, const SyncPolicy policy, const std::size_t group_size)
+        : base_(checked_base(std::move(base))), generation_(generation), log_(base_ + ".wal", policy, group_size) {}
+
+public:
+    // Start journaling tree under base, replacing whatever was stored there
+    TreeJournal(std::string base, const BinaryTree<T>& tree, const SyncPolicy policy = SyncPolicy::Group,
+                const std::size_t group_size = WriteAheadLog<T>::default_group_size)
+        : TreeJournal(std::move(base), 1, policy, group_size) {
+        remove_snapshots(base_, 0);
+        write_snapshot(tree, generation_);
+        log_.reset(generation_);
+    }
+
+    TreeJournal(const TreeJournal&) = delete;
+    TreeJournal& operator=(const TreeJournal&) = delete;
+
+    // Rebuild the tree stored under base and reopen its journal for appending
+    static std::pair<BinaryTree<T>, std::unique_ptr<TreeJournal>> recover(
+            const std::string& base, const std::size_t group_size = WriteAheadLog<T>::default_group_size) {
+        const auto generations = snapshot_generations(base);
+        if (generations.empty()) throw std::runtime_error("No checkpoint found for '" + base + "'");
+        const std::uint32_t newest = *std::max_element(generations.begin(), generations.end());
+        BinaryTree<T> tree = load_snapshot<T>(base + "." + std::to_string(newest) + ".snap");
+
+        const std::string log_path = base + ".wal";
+        const auto info = WriteAheadLog<T>::read_info(log_path);
+        const bool current = info && info->generation == newest;
+        if (current) {
+            WriteAheadLog<T>::replay(log_path, [&tree](const typename WriteAheadLog<T>::Op op, const bool repeat,
+                                                       std::vector<T>& values) {
+                switch (op) {
+                    case WriteAheadLog<T>::Op::Insert: tree.insert_node(std::move(values.front()), repeat); break;
+                    case WriteAheadLog<T>::Op::InsertMany: tree.insert_many(std::move(values), repeat); break;
+                    case WriteAheadLog<T>::Op::Clear: tree.clear(); break;
+                    case WriteAheadLog<T>::Op::Erase: tree.erase(values.front()); break;
+                    case WriteAheadLog<T>::Op::EraseAll: tree.erase_all(values.front()); break;
+                }
+            });
+        }
+
+        std::unique_ptr<TreeJournal> journal(new TreeJournal(base, newest, info ? info->policy : SyncPolicy::Group, group_size));
+        // The log predates the newest checkpoint (or was cut short while being reset)
+        if (!current) journal->log_.reset(newest);
+        remove_snapshots(base, newest);
+        std::filesystem::remove(base + "." + std::to_string(newest + 1) + ".snap.tmp");
+        return {std::move(tree), std::move(journal)};
+    }
+
+    // Tree names become file names in the journal directory: letters, digits, '_' and '-'
+    // only, so a name can never reach outside it
+    static bool valid_name(const std::string_view name) {
+        return !name.empty() && std::all_of(name.begin(), name.end(), [](const char c) {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+        });
+    }
+
+    [[nodiscard]] SyncPolicy policy() const { return log_.policy(); }
+
+    void log_insert(const T& value, const bool repeat) { log_.log_insert(value, repeat); }
+    void log_insert_many(const std::vector<T>& values, const bool repeat) { log_.log_insert_many(values, repeat); }
+    void log_erase(const T& value, const bool all) { log_.log_erase(value, all); }
+    void log_clear() { log_.log_clear(); }
+    void commit() { log_.commit(); }
+
+    // Store tree as the next checkpoint and empty the log
+    void checkpoint(const BinaryTree<T>& tree) {
+        log_.commit();
+        write_snapshot(tree, generation_ + 1);
+        log_.reset(generation_ + 1);
+        std::filesystem::remove(snapshot_path(generation_));
+        ++generation_;
+    }
+
+    [[nodiscard]] const std::string& base() const { return base_; }
+
+    // Delete the log and checkpoints stored under base (its journal must be closed first)
+    static void remove_files(const std::string& base) {
+        std::filesystem::remove(base + ".wal");
+        remove_snapshots(base, 0);
+    }
+
+    // Trees journaled in directory, as (tree name, base path) pairs
+    static std::vector<std::pair<std::string, std::string>> list(const std::string& directory) {
+        std::vector<std::pair<std::string, std::string>> trees;
+        for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+            if (!entry.is_regular_file() || entry.path().extension() != ".wal") continue;
+            const std::string name = entry.path().stem().string();
+            if (!valid_name(name)) continue;
+            trees.emplace_back(name, (std::filesystem::path(directory) / name).string());
+        }
+        return trees;
+    }
+};
+
+#endif //WRITE_AHEAD_LOG_H
@@ -2,6 +2,11 @@
 #define BINARY_TREE_PLAYGROUND_H
 
 #include "../binarytree/binary_tree.h"
+#include "../binarytree/frozen_tree.h"
+#include "../binarytree/btree.h"
+#include "../binarytree/snapshot.h"
+#include "../binarytree/write_ahead_log.h"
+#include "../binarytree/persistent_tree.h"
 #include <functional>
 #include <iostream>
 #include <sstream>
@@ -11,6 +16,17 @@
 #include <vector>
 #include <algorithm>
 #include <iomanip>
+#include <filesystem>
+#include <fstream>
+#include <variant>
+#include <cmath>
+#include <charconv>
+#include <chrono>
+#include <string_view>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <map>
 
 namespace Colors {
     // ANSI color codes for terminal output
@@ -30,8 +46,8 @@ namespace BinaryTreePlayground {
     // Convert any value type to string for display purposes
     template<typename T>
     std::string value_to_string(const T& value) {
-        if constexpr (std::is_same_v<T, std::string>) {
-            return value;
+        if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            return std::string(value);
         } else if constexpr (std::is_same_v<T, char>) {
             return std::string(1, value);
         } else {
@@ -39,153 +55,669 @@ namespace BinaryTreePlayground {
         }
     }
 
+    // Parse one whitespace-free token the way `istream >> value` would, without building a
+    // stream. Returns false when the fast path cannot decide; callers then fall back to the stream.
+    template<typename T>
+    bool parse_token(const std::string_view token, T& value) {
+        if constexpr (std::is_same_v<T, std::string>) {
+            value.assign(token);
+            return true;
+        } else if constexpr (std::is_same_v<T, char>) {
+            if (token.size() != 1) return false;
+            value = token.front();
+            return true;
+        } else {
+            const auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+            if (error != std::errc() || end != token.data() + token.size()) return false;
+            // from_chars takes "nan" and "inf", which the stream rejects (and NaN has no order)
+            if constexpr (std::is_floating_point_v<T>) return std::isfinite(value);
+            return true;
+        }
+    }
+
+    // Output buffer for batch runs: collects everything written to std::cout and passes it on
+    // in large chunks. sync() (std::endl, std::flush) is ignored; flush() writes it out.
+    class BatchOutputBuffer : public std::streambuf {
+    private:
+        std::streambuf* target_;
+        std::vector<char> buffer_;
+
+    protected:
+        int_type overflow(const int_type ch) override {
+            flush();
+            if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+                *pptr() = traits_type::to_char_type(ch);
+                pbump(1);
+            }
+            return traits_type::not_eof(ch);
+        }
+
+        int sync() override { return 0; }
+
+    public:
+        explicit BatchOutputBuffer(std::streambuf* target, const std::size_t capacity = 1 << 16)
+            : target_(target), buffer_(capacity) {
+            setp(buffer_.data(), buffer_.data() + buffer_.size());
+        }
+
+        ~BatchOutputBuffer() override { flush(); }
+
+        void flush() {
+            target_->sputn(pbase(), pptr() - pbase());
+            target_->pubsync();
+            setp(buffer_.data(), buffer_.data() + buffer_.size());
+        }
+    };
+
+    // Latency histogram with eight linear sub-buckets per power of two, so every recorded
+    // value is known to within 12.5%; the maximum is kept exactly
+    class LatencyHistogram {
+    private:
+        static constexpr int sub_bits = 3;
+        static constexpr std::size_t sub_buckets = 1 << sub_bits;
+
+        std::array<std::uint64_t, 64 * sub_buckets> buckets_{};
+        std::uint64_t count_ = 0;
+        std::uint64_t max_ = 0;
+
+        static std::size_t bucket_of(const std::uint64_t ns) {
+            if (ns < sub_buckets) return ns;
+            const int exponent = std::bit_width(ns) - 1;
+            const std::uint64_t sub = (ns >> (exponent - sub_bits)) & (sub_buckets - 1);
+            return static_cast<std::size_t>(exponent - sub_bits + 1) * sub_buckets + sub;
+        }
+
+    public:
+        // Largest value that lands in bucket
+        static std::uint64_t bucket_limit(const std::size_t bucket) {
+            if (bucket < sub_buckets) return bucket;
+            const int exponent = static_cast<int>(bucket / sub_buckets) + sub_bits - 1;
+            const std::uint64_t sub = bucket % sub_buckets;
+            return ((sub_buckets + sub + 1) << (exponent - sub_bits)) - 1;
+        }
+
+        void record(const std::uint64_t ns) {
+            ++buckets_[bucket_of(ns)];
+            ++count_;
+            max_ = std::max(max_, ns);
+        }
+
+        // Value below which p percent of the samples fall (upper edge of its bucket)
+        [[nodiscard]] std::uint64_t percentile(const double p) const {
+            const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(p / 100.0 * static_cast<double>(count_))));
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < buckets_.size(); ++i) {
+                seen += buckets_[i];
+                if (seen >= rank) return std::min(bucket_limit(i), max_);
+            }
+            return max_;
+        }
+
+        [[nodiscard]] std::uint64_t count() const { return count_; }
+        [[nodiscard]] std::uint64_t max() const { return max_; }
+        [[nodiscard]] const auto& buckets() const { return buckets_; }
+        [[nodiscard]] static constexpr std::size_t buckets_per_octave() { return sub_buckets; }
+    };
+
+    // Everything recorded for one command name
+    struct CommandProfile {
+        LatencyHistogram latency;
+        std::uint64_t total_ns = 0;
+        std::uint64_t node_visits = 0;
+        std::uint64_t allocations = 0;
+    };
+
+    // Per-command latency and tree counters. While disabled, measure() is one branch and
+    // the tree operations skip their counters (see tree_counters.h).
+    class CommandProfiler {
+    private:
+        bool enabled_ = false;
+        std::map<std::string, CommandProfile, std::less<>> profiles_;
+
+        void record(const std::string_view command, const std::uint64_t ns, const tree_counters::Totals& before) {
+            auto it = profiles_.find(command);
+            if (it == profiles_.end()) it = profiles_.emplace(std::string(command), CommandProfile{}).first;
+            const tree_counters::Totals after = tree_counters::totals();
+            it->second.latency.record(ns);
+            it->second.total_ns += ns;
+            it->second.node_visits += after.node_visits - before.node_visits;
+            it->second.allocations += after.allocations - before.allocations;
+        }
+
+    public:
+        // Times one command from construction to destruction, including when it throws
+        class Scope {
+        private:
+            CommandProfiler* profiler_ = nullptr;
+            std::string_view command_;
+            tree_counters::Totals counters_;
+            std::chrono::steady_clock::time_point start_;
+
+            friend class CommandProfiler;
+            Scope(CommandProfiler* profiler, const std::string_view command)
+                : profiler_(profiler), command_(command), counters_(tree_counters::totals()),
+                  start_(std::chrono::steady_clock::now()) {}
+
+        public:
+            Scope() = default;
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+            ~Scope() {
+                if (profiler_ == nullptr) return;
+                const auto elapsed = std::chrono::steady_clock::now() - start_;
+                profiler_->record(command_, static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()), counters_);
+            }
+
+            // Drop the measurement (the command turned out not to exist)
+            void cancel() { profiler_ = nullptr; }
+        };
+
+        CommandProfiler() = default;
+        CommandProfiler(const CommandProfiler&) = delete;
+        CommandProfiler& operator=(const CommandProfiler&) = delete;
+        ~CommandProfiler() { enable(false); }
+
+        // command must outlive the returned scope; 'profile' itself is never recorded
+        [[nodiscard]] Scope measure(const std::string_view command) {
+            if (!enabled_ || command == "profile") return Scope();
+            return Scope(this, command);
+        }
+
+        void enable(const bool on) {
+            enabled_ = on;
+            tree_counters::enabled.store(on, std::memory_order_relaxed);
+        }
+
+        void reset() { profiles_.clear(); }
+
+        [[nodiscard]] bool enabled() const { return enabled_; }
+        [[nodiscard]] const auto& profiles() const { return profiles_; }
+    };
+
+    // Short human-readable duration: 850 ns, 12.3 us, 4.5 ms, 1.20 s
+    inline std::string format_duration(const std::uint64_t ns) {
+        std::ostringstream out;
+        out << std::fixed;
+        if (ns < 1000) out << ns << " ns";
+        else if (ns < 1000000) out << std::setprecision(1) << static_cast<double>(ns) / 1e3 << " us";
+        else if (ns < 1000000000) out << std::setprecision(1) << static_cast<double>(ns) / 1e6 << " ms";
+        else out << std::setprecision(2) << static_cast<double>(ns) / 1e9 << " s";
+        return out.str();
+    }
+
+    // Fixed-capacity history that overwrites its oldest entry once full. push() hands back the
+    // slot to fill, so entries (and any strings inside them) reuse their storage.
+    template<typename Entry, std::size_t Capacity>
+    class RingBuffer {
+    private:
+        std::array<Entry, Capacity> entries_{};
+        std::size_t next_ = 0;   // Slot the next push() overwrites
+        std::size_t size_ = 0;
+
+    public:
+        Entry& push() {
+            Entry& slot = entries_[next_];
+            next_ = (next_ + 1) % Capacity;
+            if (size_ < Capacity) ++size_;
+            return slot;
+        }
+
+        [[nodiscard]] std::size_t size() const { return size_; }
+        [[nodiscard]] bool empty() const { return size_ == 0; }
+
+        // i-th entry, oldest first
+        const Entry& operator[](const std::size_t i) const {
+            return entries_[(next_ + Capacity - size_ + i) % Capacity];
+        }
+    };
+
+    // Storage backend of a playground tree
+    enum class Backend {
+        Binary,  // BinaryTree with the selected balance/duplicate modes
+        BTree,      // Wide-node B-tree (always balanced, duplicates counted)
+        Map,        // BinaryTree holding a text value per key (put/get)
+        Persistent  // Copy-on-write tree with O(1) clone and snapshot/rollback
+    };
+
+    inline const char* backend_name(const Backend backend) {
+        switch (backend) {
+            case Backend::BTree: return "B-tree";
+            case Backend::Map: return "map";
+            case Backend::Persistent: return "persistent";
+            default: return "binary";
+        }
+    }
+
     // Wrapper class that adds history tracking and utility methods to BinaryTree
     template<typename T>
     class TreeWrapper {
     private:
-        std::unique_ptr<BinaryTree<T>> tree_;  // The actual binary tree
+        using MapTree = BinaryTree<T, std::string>;
+        using TreeVariant = std::variant<std::unique_ptr<BinaryTree<T>>, std::unique_ptr<BTree<T>>, std::unique_ptr<MapTree>,
+                                         std::unique_ptr<PersistentTree<T>>>;
+
+        TreeVariant tree_;                     // The actual tree, whichever backend was chosen
         std::string name_;                     // Name identifier for this tree
-        std::vector<std::string> history_;     // Operation history (last 20 operations)
+        // One history record. The hot operations keep their arguments and are formatted only
+        // when the history is shown; everything else is stored as text.
+        struct HistoryEntry {
+            enum class Op { Text, Insert, Search, Count, Erase, EraseAll } op = Op::Text;
+            T value{};
+            int result = 0;
+            std::string text;
+        };
+
+        RingBuffer<HistoryEntry, 20> history_;  // Operation history (last 20 operations)
+        std::unique_ptr<FrozenTree<T>> frozen_; // Read-optimized snapshot, dropped on mutation
+        std::unique_ptr<TreeJournal<T>> journal_; // Write-ahead log and checkpoints, if enabled
+        std::vector<PersistentTree<T>> snapshots_;  // Saved versions of a persistent tree, oldest first
+
+        // Run an operation on whichever backend holds the tree
+        template<typename F>
+        decltype(auto) visit_tree(F&& f) {
+            return std::visit([&](auto& tree) -> decltype(auto) { return f(*tree); }, tree_);
+        }
+
+        template<typename F>
+        decltype(auto) visit_tree(F&& f) const {
+            return std::visit([&](const auto& tree) -> decltype(auto) { return f(std::as_const(*tree)); }, tree_);
+        }
+
+        std::runtime_error unsupported(const std::string& operation) const {
+            return std::runtime_error("'" + operation + "' is not supported by the " +
+                                      backend_name(get_backend()) + " backend");
+        }
+
+        // Access the BinaryTree backend for operations only the set tree provides
+        BinaryTree<T>& binary_tree(const std::string& operation) const {
+            auto* tree = std::get_if<std::unique_ptr<BinaryTree<T>>>(&tree_);
+            if (tree == nullptr) throw unsupported(operation);
+            return **tree;
+        }
+
+        // Access the map backend for put/get
+        MapTree& map_tree(const std::string& operation) const {
+            auto* tree = std::get_if<std::unique_ptr<MapTree>>(&tree_);
+            if (tree == nullptr) throw std::runtime_error("'" + operation + "' needs a map tree (create <name> map)");
+            return **tree;
+        }
+
+        // Access the persistent backend for clone/snapshot/rollback
+        PersistentTree<T>& persistent_tree(const std::string& operation) const {
+            auto* tree = std::get_if<std::unique_ptr<PersistentTree<T>>>(&tree_);
+            if (tree == nullptr) throw std::runtime_error("'" + operation + "' needs a persistent tree (create <name> persistent)");
+            return **tree;
+        }
+
+        // Run an operation on the BinaryTree or map backend, for the node-level operations
+        // the B-tree and the persistent tree do not provide
+        template<typename F>
+        auto visit_ordered(const std::string& operation, F&& f) const -> decltype(f(std::declval<const BinaryTree<T>&>())) {
+            using Result = decltype(f(std::declval<const BinaryTree<T>&>()));
+            return std::visit([&](const auto& tree) -> Result {
+                using Tree = std::decay_t<decltype(*tree)>;
+                if constexpr (std::is_same_v<Tree, BinaryTree<T>> || std::is_same_v<Tree, MapTree>) return f(std::as_const(*tree));
+                else throw unsupported(operation);
+            }, tree_);
+        }
 
     public:
-        explicit TreeWrapper(std::string name) : name_(std::move(name)) {
-            tree_ = std::make_unique<BinaryTree<T>>();
+        explicit TreeWrapper(std::string name, const BalanceMode balance = BalanceMode::None,
+                             const DuplicateMode duplicates = DuplicateMode::Chain,
+                             const Backend backend = Backend::Binary)
+            : name_(std::move(name)) {
+            if (backend == Backend::BTree) tree_ = std::make_unique<BTree<T>>();
+            else if (backend == Backend::Map) tree_ = std::make_unique<MapTree>(balance, duplicates);
+            else if (backend == Backend::Persistent) tree_ = std::make_unique<PersistentTree<T>>(balance, duplicates);
+            else tree_ = std::make_unique<BinaryTree<T>>(balance, duplicates);
         }
 
+        // Wrap an already built tree, e.g. one loaded from a snapshot or recovered from its journal
+        TreeWrapper(std::string name, BinaryTree<T> tree, std::unique_ptr<TreeJournal<T>> journal = nullptr)
+            : tree_(std::make_unique<BinaryTree<T>>(std::move(tree))), name_(std::move(name)),
+              journal_(std::move(journal)) {}
+
+        // Wrap a version of a persistent tree, e.g. a clone
+        TreeWrapper(std::string name, PersistentTree<T> tree)
+            : tree_(std::make_unique<PersistentTree<T>>(std::move(tree))), name_(std::move(name)) {}
+
         // Getters
         [[nodiscard]] const std::string &get_name() const { return name_; }
-        BinaryTree<T>* get_tree() { return tree_.get(); }
-        const BinaryTree<T>* get_tree() const { return tree_.get(); }
-        [[nodiscard]] const std::vector<std::string>& get_history() const { return history_; }
+        BinaryTree<T>* get_tree() {
+            auto* tree = std::get_if<std::unique_ptr<BinaryTree<T>>>(&tree_);
+            return tree ? tree->get() : nullptr;
+        }
+        const BinaryTree<T>* get_tree() const {
+            auto* tree = std::get_if<std::unique_ptr<BinaryTree<T>>>(&tree_);
+            return tree ? tree->get() : nullptr;
+        }
+        // Operation history, oldest first
+        [[nodiscard]] std::vector<std::string> get_history() const {
+            std::vector<std::string> lines;
+            lines.reserve(history_.size());
+            for (std::size_t i = 0; i < history_.size(); ++i) {
+                const HistoryEntry& entry = history_[i];
+                switch (entry.op) {
+                    case HistoryEntry::Op::Text: lines.push_back(entry.text); break;
+                    case HistoryEntry::Op::Insert: lines.push_back("insert " + value_to_string(entry.value)); break;
+                    case HistoryEntry::Op::Search:
+                        lines.push_back("search " + value_to_string(entry.value) + " -> " + (entry.result ? "found" : "not found"));
+                        break;
+                    case HistoryEntry::Op::Count:
+                        lines.push_back("count " + value_to_string(entry.value) + " -> " + std::to_string(entry.result));
+                        break;
+                    case HistoryEntry::Op::Erase:
+                    case HistoryEntry::Op::EraseAll:
+                        lines.push_back((entry.op == HistoryEntry::Op::Erase ? "erase " : "eraseall ") +
+                                        value_to_string(entry.value) + " -> " + std::to_string(entry.result) + " removed");
+                        break;
+                }
+            }
+            return lines;
+        }
+        [[nodiscard]] Backend get_backend() const {
+            if (std::holds_alternative<std::unique_ptr<BTree<T>>>(tree_)) return Backend::BTree;
+            if (std::holds_alternative<std::unique_ptr<MapTree>>(tree_)) return Backend::Map;
+            return std::holds_alternative<std::unique_ptr<PersistentTree<T>>>(tree_) ? Backend::Persistent : Backend::Binary;
+        }
+        // The B-tree is always balanced and always counts duplicates
+        [[nodiscard]] BalanceMode get_balance() const {
+            return visit_tree([](const auto& tree) {
+                if constexpr (requires { tree.get_balance(); }) return tree.get_balance();
+                else return BalanceMode::None;
+            });
+        }
+        [[nodiscard]] DuplicateMode get_duplicates() const {
+            return visit_tree([](const auto& tree) {
+                if constexpr (requires { tree.get_duplicates(); }) return tree.get_duplicates();
+                else return DuplicateMode::Counted;
+            });
+        }
+        [[nodiscard]] std::size_t snapshot_count() const { return snapshots_.size(); }
 
-        // Add operation to history with size limit
+        // Add operation to history, dropping the oldest beyond 20
         void add_to_history(const std::string& operation) {
-            history_.push_back(operation);
-            if (history_.size() > 20) {
-                history_.erase(history_.begin());
-            }
+            HistoryEntry& entry = history_.push();
+            entry.op = HistoryEntry::Op::Text;
+            entry.text = operation;
+        }
+
+        // Record a hot operation without formatting it
+        void add_to_history(const typename HistoryEntry::Op op, lookup_key_t<T> value, const int result = 0) {
+            HistoryEntry& entry = history_.push();
+            entry.op = op;
+            entry.value = value;
+            entry.result = result;
+        }
+
+        [[nodiscard]] bool frozen() const { return frozen_ != nullptr; }
+
+        // Compile the current contents into a read-only snapshot for search/count
+        void freeze() {
+            frozen_ = std::make_unique<FrozenTree<T>>(binary_tree("freeze").get_root());
+            add_to_history("freeze");
+        }
+
+        [[nodiscard]] bool journaled() const { return journal_ != nullptr; }
+
+        // Start logging mutations under base (base.wal plus checkpoints), replacing old files
+        void enable_journal(const std::string& base, const SyncPolicy policy) {
+            journal_ = std::make_unique<TreeJournal<T>>(base, binary_tree("wal"), policy);
+            add_to_history(std::string("wal on ") + (policy == SyncPolicy::EveryOp ? "sync" : "group"));
+        }
+
+        // Stop logging and delete the log and checkpoints
+        void disable_journal() {
+            if (!journal_) return;
+            const std::string base = journal_->base();
+            journal_.reset();
+            TreeJournal<T>::remove_files(base);
+            add_to_history("wal off");
+        }
+
+        // Store the current contents as a checkpoint and empty the log
+        void checkpoint() {
+            if (!journal_) throw std::runtime_error("Logging is not enabled for this tree (use 'wal on')");
+            journal_->checkpoint(binary_tree("checkpoint"));
+            add_to_history("checkpoint");
+        }
+
+        // This tree combined with other into a new balanced tree, in O(n + m)
+        BinaryTree<T> combined(const TreeWrapper& other, const SetOperation operation, const std::string& command) const {
+            return BinaryTree<T>::combine(binary_tree(command), other.binary_tree(command), operation);
+        }
+
+        // Replace the contents with tree; a logged tree is checkpointed, since the log has no
+        // record for a wholesale replacement
+        void assign(BinaryTree<T> tree, const std::string& operation) {
+            BinaryTree<T>& current = binary_tree(operation);
+            current = std::move(tree);
+            frozen_.reset();
+            if (journal_) journal_->checkpoint(current);
+            add_to_history(operation);
+        }
+
+        // Make logged operations durable (end of a commit group)
+        void commit_journal() {
+            if (journal_) journal_->commit();
         }
 
-        // Insert value into the tree and record operation
-        void insert(const T &value, bool& repeat) {
-            tree_->insert_node(value, repeat);
-            add_to_history("insert " + value_to_string(value));
+        // Write the tree to a binary snapshot file
+        void save(const std::string& path) {
+            save_snapshot(binary_tree("save"), path);
+            add_to_history("save " + path);
+        }
+
+        // Insert value into the tree and record operation; the value is moved into its node
+        void insert(T value, bool& repeat) {
+            if (journal_) journal_->log_insert(value, repeat);
+            frozen_.reset();
+            add_to_history(HistoryEntry::Op::Insert, value);
+            visit_tree([&](auto& tree) { tree.insert_node(std::move(value), repeat); });
+        }
+
+        // Bulk-insert values (tree is rebuilt balanced) and record operation
+        void insert_many(std::vector<T> values, const bool repeat) {
+            const std::size_t count = values.size();
+            if (journal_) journal_->log_insert_many(values, repeat);
+            frozen_.reset();
+            visit_tree([&](auto& tree) { tree.insert_many(std::move(values), repeat); });
+            add_to_history("insertmany " + std::to_string(count) + " values");
+        }
+
+        // Remove one copy of value, or every copy when all is set; returns how many were removed
+        int erase(const T& value, const bool all) {
+            if (journal_) journal_->log_erase(value, all);
+            frozen_.reset();
+            const int removed = visit_tree([&](auto& tree) {
+                return all ? tree.erase_all(value) : static_cast<int>(tree.erase(value));
+            });
+            add_to_history(all ? HistoryEntry::Op::EraseAll : HistoryEntry::Op::Erase, value, removed);
+            return removed;
         }
 
         // Search for value in tree and record operation with result
-        bool search(const T &value) {
-            const bool result = tree_->search(value);
-            add_to_history("search " + value_to_string(value) + " -> " + (result ? "found" : "not found"));
+        bool search(lookup_key_t<T> value) {
+            const bool result = frozen_ ? frozen_->search(value)
+                                        : visit_tree([&](const auto& tree) { return tree.search(value); });
+            add_to_history(HistoryEntry::Op::Search, value, result);
             return result;
         }
 
         // Perform inorder traversal and capture output
         std::string inorder() {
-            const std::stringstream buffer;
-            std::streambuf* old = std::cout.rdbuf(buffer.rdbuf());
-            tree_->inorder();
-            std::cout.rdbuf(old);
+            std::ostringstream buffer;
+            visit_tree([&buffer](const auto& tree) { tree.inorder(buffer); });
             add_to_history("inorder");
             return buffer.str();
         }
 
         // Perform preorder traversal and capture output
         std::string preorder() {
-            const std::stringstream buffer;
-            std::streambuf* old = std::cout.rdbuf(buffer.rdbuf());
-            tree_->preorder();
-            std::cout.rdbuf(old);
+            std::ostringstream buffer;
+            visit_tree([&buffer](const auto& tree) { tree.preorder(buffer); });
             add_to_history("preorder");
             return buffer.str();
         }
 
-        // Count occurrences of value in tree
-        int count_entries(const T &value) {
-            const int count = tree_->count_entries(value);
-            add_to_history("count " + value_to_string(value) + " -> " + std::to_string(count));
+        // Perform postorder traversal and capture output
+        std::string postorder() {
+            std::ostringstream buffer;
+            visit_tree([&](const auto& tree) {
+                if constexpr (requires { tree.postorder(buffer); }) tree.postorder(buffer);
+                else throw unsupported("postorder");
+            });
+            add_to_history("postorder");
+            return buffer.str();
+        }
+
+        // Count occurrences of value in tree, splitting full scans over pool when given
+        int count_entries(lookup_key_t<T> value, WorkStealingPool* pool = nullptr) {
+            const int count = frozen_ ? frozen_->count_entries(value) : visit_tree([&](const auto& tree) {
+                if constexpr (requires { tree.count_entries(value, std::cout, pool); }) return tree.count_entries(value, std::cout, pool);
+                else return tree.count_entries(value);
+            });
+            add_to_history(HistoryEntry::Op::Count, value, count);
             return count;
         }
 
         // Get path to value in tree
-        std::string get_path(const T &value) {
-            const std::stringstream buffer;
-            std::streambuf* old = std::cout.rdbuf(buffer.rdbuf());
-            tree_->get_path(value);
-            std::cout.rdbuf(old);
+        std::string get_path(lookup_key_t<T> value, WorkStealingPool* pool = nullptr) {
+            std::ostringstream buffer;
+            visit_ordered("path", [&](const auto& tree) { tree.get_path(value, buffer, pool); });
             add_to_history("path " + value_to_string(value));
             return buffer.str();
         }
 
         // Print tree structure
         std::string print_tree() {
-            const std::stringstream buffer;
-            std::streambuf* old = std::cout.rdbuf(buffer.rdbuf());
-            tree_->print_tree();
-            std::cout.rdbuf(old);
+            std::ostringstream buffer;
+            visit_tree([&buffer](const auto& tree) { tree.print_tree(buffer); });
             add_to_history("print");
             return buffer.str();
         }
 
         std::string find_level() {
-            const std::stringstream buffer;
-            std::streambuf* old = std::cout.rdbuf(buffer.rdbuf());
-            tree_->find_levels();
-            std::cout.rdbuf(old);
+            std::ostringstream buffer;
+            visit_tree([&buffer](const auto& tree) { tree.find_levels(buffer); });
             add_to_history("find level");
             return buffer.str();
         }
 
         // Check if tree is empty
         [[nodiscard]] bool empty() const {
-            return tree_->get_root() == nullptr;
+            return visit_tree([](const auto& tree) { return tree.empty(); });
         }
 
-        // Get number of nodes in tree
+        // Get number of stored values (duplicates included) in O(1)
         [[nodiscard]] int size() const {
-            return count_nodes(tree_->get_root());
+            return visit_tree([](const auto& tree) { return static_cast<int>(tree.size()); });
         }
 
-        // Clear all nodes from tree
-        void clear() {
-            tree_ = std::make_unique<BinaryTree<T>>();
-            add_to_history("clear");
+        // Number of values smaller than value
+        int rank(lookup_key_t<T> value) {
+            const int result = visit_ordered("rank", [&](const auto& tree) { return tree.rank(value); });
+            add_to_history("rank " + value_to_string(value) + " -> " + std::to_string(result));
+            return result;
         }
 
-        // Display tree statistics
-        void print_stats() const {
-            auto root = tree_->get_root();
-            if (!root) {
-                std::cout << Colors::YELLOW << "Tree is empty" << Colors::RESET << std::endl;
-                return;
-            }
+        // Values in [lo, hi] in sorted order (empty string when there are none)
+        std::string range(lookup_key_t<T> lo, lookup_key_t<T> hi) {
+            std::ostringstream buffer;
+            const int found = visit_ordered("range", [&](const auto& tree) { return tree.range(lo, hi, buffer); });
+            add_to_history("range " + value_to_string(lo) + " " + value_to_string(hi) + " -> " + std::to_string(found));
+            return found ? buffer.str() : std::string();
+        }
 
-            std::cout << Colors::CYAN << "=== Tree Statistics ===" << Colors::RESET << std::endl;
-            std::cout << "Root value: " << Colors::BOLD << root->data << Colors::RESET << std::endl;
-            std::cout << "Total nodes: " << Colors::BOLD << count_nodes(root) << Colors::RESET << std::endl;
-            std::cout << Colors::BOLD;
-            tree_->find_levels();
-            std::cout << Colors::RESET;
-            std::cout << "Min value: " << Colors::BOLD << find_min(root) << Colors::RESET << std::endl;
-            std::cout << "Max value: " << Colors::BOLD << find_max(root) << Colors::RESET << std::endl;
+        // Number of values in [lo, hi]
+        int count_range(lookup_key_t<T> lo, lookup_key_t<T> hi) {
+            const int result = visit_ordered("rangecount", [&](const auto& tree) { return tree.count_range(lo, hi); });
+            add_to_history("rangecount " + value_to_string(lo) + " " + value_to_string(hi) + " -> " + std::to_string(result));
+            return result;
         }
 
-    private:
-        // Recursively count nodes in subtree
-        int count_nodes(const Node<T>* node) const {
-            if (!node) return 0;
-            return 1 + count_nodes(node->left) + count_nodes(node->right);
+        // Value at zero-based position k in sorted order
+        T select(const int k) {
+            T result = visit_ordered("select", [k](const auto& tree) { return tree.select(k); });
+            add_to_history("select " + std::to_string(k) + " -> " + value_to_string(result));
+            return result;
+        }
+
+        // Store value under key in a map tree; returns whether key was new
+        bool put(T key, std::string value) {
+            MapTree& tree = map_tree("put");
+            add_to_history("put " + value_to_string(key));
+            return tree.put(std::move(key), std::move(value));
+        }
+
+        // Value stored under key in a map tree (nullptr when absent)
+        const std::string* get(lookup_key_t<T> key) {
+            const std::string* result = std::as_const(map_tree("get")).get(key);
+            add_to_history("get " + value_to_string(key) + " -> " + (result ? "found" : "not found"));
+            return result;
+        }
+
+        // New tree named name sharing this persistent tree's nodes, in O(1)
+        std::unique_ptr<TreeWrapper> clone(const std::string& name) {
+            auto copy = std::make_unique<TreeWrapper>(name, persistent_tree("clone").clone());
+            copy->add_to_history("clone of " + name_);
+            add_to_history("clone -> " + name);
+            return copy;
         }
 
-        // Find minimum value in subtree
-        T find_min(const Node<T>* node) const {
-            while (node && node->left) node = node->left;
-            return node ? node->data : T{};
+        // Save the current version of a persistent tree in O(1); returns the snapshot count
+        std::size_t snapshot() {
+            snapshots_.push_back(persistent_tree("snapshot").clone());
+            add_to_history("snapshot " + std::to_string(snapshots_.size()));
+            return snapshots_.size();
+        }
+
+        // Return to the newest snapshot and drop it; versions after it are released
+        void rollback() {
+            PersistentTree<T>& tree = persistent_tree("rollback");
+            if (snapshots_.empty()) throw std::runtime_error("No snapshot to roll back to (use 'snapshot' first)");
+            tree = std::move(snapshots_.back());
+            snapshots_.pop_back();
+            add_to_history("rollback to snapshot " + std::to_string(snapshots_.size() + 1));
+        }
+
+        // Clear all nodes from tree
+        void clear() {
+            if (journal_) journal_->log_clear();
+            frozen_.reset();
+            visit_tree([](auto& tree) { tree.clear(); });
+            add_to_history("clear");
         }
 
-        // Find maximum value in subtree
-        T find_max(const Node<T>* node) const {
-            while (node && node->right) node = node->right;
-            return node ? node->data : T{};
+        // Display tree statistics
+        void print_stats(const bool colors) const {
+            // Escape codes only when the playground shows colors (never in batch mode)
+            const auto style = [colors](const std::string& code) { return colors ? code : std::string(); };
+            if (empty()) {
+                std::cout << style(Colors::YELLOW) << "Tree is empty" << style(Colors::RESET) << std::endl;
+                return;
+            }
+
+            std::cout << style(Colors::CYAN) << "=== Tree Statistics ===" << style(Colors::RESET) << std::endl;
+            const Backend backend = get_backend();
+            if (backend != Backend::Binary) std::cout << "Backend: " << style(Colors::BOLD) << backend_name(backend) << style(Colors::RESET) << std::endl;
+            visit_tree([&](const auto& tree) {
+                if constexpr (std::is_same_v<std::decay_t<decltype(tree)>, BTree<T>>) {
+                    std::cout << "Total values: " << style(Colors::BOLD) << tree.size() << style(Colors::RESET) << std::endl;
+                } else {
+                    auto root = tree.get_root();
+                    std::cout << "Root value: " << style(Colors::BOLD) << root->data << style(Colors::RESET) << std::endl;
+                    std::cout << (tree.get_duplicates() == DuplicateMode::Counted ? "Total values: " : "Total nodes: ")
+                              << style(Colors::BOLD) << tree.size() << style(Colors::RESET) << std::endl;
+                }
+                std::cout << style(Colors::BOLD);
+                tree.find_levels();
+                std::cout << style(Colors::RESET);
+                std::cout << "Min value: " << style(Colors::BOLD) << tree.min() << style(Colors::RESET) << std::endl;
+                std::cout << "Max value: " << style(Colors::BOLD) << tree.max() << style(Colors::RESET) << std::endl;
+                if (!snapshots_.empty()) std::cout << "Snapshots: " << style(Colors::BOLD) << snapshots_.size() << style(Colors::RESET) << std::endl;
+            });
         }
     };
 
@@ -199,16 +731,32 @@ namespace BinaryTreePlayground {
         int tree_counter_ = 0;            // Counter for auto-generating tree names
         std::vector<std::string> command_history_;  // Command history (last 20 commands)
         bool show_colors_ = true;         // Flag for colored output
+        bool quiet_ = false;              // Batch mode: no prompts or confirmations
+        std::unique_ptr<WorkStealingPool> pool_;  // Workers for full-tree scans (none = single thread)
+        std::string journal_dir_;         // Where 'wal on' keeps logs (empty = logging unavailable)
+        CommandProfiler profiler_;        // Per-command timings, collected after 'profile on'
 
         // Initialize all supported commands with their handlers
         void initialize_commands() {
             commands_ = {
-                // Create a new tree with optional name
+                // Create a new tree with optional name, balancing and duplicate modes
                 {
                     "create", [this](std::istringstream &iss) {
                         std::string name;
                         if (!(iss >> name)) name = generate_tree_name();
-                        handle_create(name);
+                        BalanceMode balance = BalanceMode::None;
+                        DuplicateMode duplicates = DuplicateMode::Chain;
+                        Backend backend = Backend::Binary;
+                        std::string option;
+                        while (iss >> option) {
+                            if (option == "avl") balance = BalanceMode::AVL;
+                            else if (option == "counted") duplicates = DuplicateMode::Counted;
+                            else if (option == "btree") backend = Backend::BTree;
+                            else if (option == "map") backend = Backend::Map;
+                            else if (option == "persistent") backend = Backend::Persistent;
+                            else throw std::runtime_error("Unknown tree option: '" + option + "'");
+                        }
+                        handle_create(name, balance, duplicates, backend);
                     }
                 },
                 // Switch to using specified tree
@@ -233,7 +781,7 @@ namespace BinaryTreePlayground {
                         T value;
                         bool repeat;
                         if (!(iss >> value) || !(iss >> repeat)) throw std::runtime_error("Invalid value");
-                        handle_insert(value, repeat);
+                        handle_insert(std::move(value), repeat);
                     }
                 },
                 // Insert value into current tree (alias)
@@ -242,7 +790,34 @@ namespace BinaryTreePlayground {
                         T value;
                         bool repeat;
                         if (!(iss >> value) || !(iss >> repeat)) throw std::runtime_error("Invalid value");
-                        handle_insert(value, repeat);
+                        handle_insert(std::move(value), repeat);
+                    }
+                },
+                // Bulk-insert values listed on the command line
+                {
+                    "insertmany", [this](std::istringstream &iss) {
+                        bool repeat;
+                        if (!(iss >> repeat)) throw std::runtime_error("Invalid repeat flag");
+                        std::vector<T> values;
+                        T value;
+                        while (iss >> value) values.push_back(value);
+                        if (!iss.eof() || values.empty()) throw std::runtime_error("Invalid value");
+                        handle_insert_many(std::move(values), repeat);
+                    }
+                },
+                // Bulk-insert whitespace-separated values read from a file
+                {
+                    "insertfile", [this](std::istringstream &iss) {
+                        std::string path;
+                        bool repeat;
+                        if (!(iss >> path) || !(iss >> repeat)) throw std::runtime_error("Usage: insertfile <file> <repeat>");
+                        std::ifstream file(path);
+                        if (!file) throw std::runtime_error("Cannot open file '" + path + "'");
+                        std::vector<T> values;
+                        T value;
+                        while (file >> value) values.push_back(value);
+                        if (!file.eof()) throw std::runtime_error("Invalid value in '" + path + "'");
+                        handle_insert_many(std::move(values), repeat);
                     }
                 },
                 // Search for value in current tree
@@ -253,10 +828,28 @@ namespace BinaryTreePlayground {
                         handle_search(value);
                     }
                 },
+                // Remove one copy of value from current tree
+                {
+                    "erase", [this](std::istringstream &iss) {
+                        T value;
+                        if (!(iss >> value)) throw std::runtime_error("Invalid value");
+                        handle_erase(value, false);
+                    }
+                },
+                // Remove every copy of value from current tree
+                {
+                    "eraseall", [this](std::istringstream &iss) {
+                        T value;
+                        if (!(iss >> value)) throw std::runtime_error("Invalid value");
+                        handle_erase(value, true);
+                    }
+                },
                 // Perform inorder traversal
                 {"inorder", [this](std::istringstream&) { handle_inorder(); }},
                 // Perform preorder traversal
                 {"preorder", [this](std::istringstream &) { handle_preorder(); }},
+                // Perform postorder traversal
+                {"postorder", [this](std::istringstream &) { handle_postorder(); }},
                 // Count occurrences of value
                 {
                     "count", [this](std::istringstream &iss) {
@@ -273,6 +866,136 @@ namespace BinaryTreePlayground {
                         handle_path(value);
                     }
                 },
+                // Write current tree to a binary snapshot
+                {
+                    "save", [this](std::istringstream &iss) {
+                        std::string path;
+                        if (!(iss >> path)) throw std::runtime_error("Usage: save <file>");
+                        handle_save(path);
+                    }
+                },
+                // Load a snapshot into a new tree
+                {
+                    "load", [this](std::istringstream &iss) {
+                        std::string path, name;
+                        if (!(iss >> path)) throw std::runtime_error("Usage: load <file> [name]");
+                        if (!(iss >> name)) name = generate_tree_name();
+                        handle_load(path, name);
+                    }
+                },
+                // Combine two trees into a third (or into the first); see handle_combine
+                {
+                    "merge", [this](std::istringstream &iss) { handle_combine("merge", SetOperation::Merge, iss); }
+                },
+                {
+                    "union", [this](std::istringstream &iss) { handle_combine("union", SetOperation::Union, iss); }
+                },
+                {
+                    "intersect", [this](std::istringstream &iss) { handle_combine("intersect", SetOperation::Intersection, iss); }
+                },
+                {
+                    "diff", [this](std::istringstream &iss) { handle_combine("diff", SetOperation::Difference, iss); }
+                },
+                // Copy a persistent tree in O(1); the copy shares every node until either changes
+                {
+                    "clone", [this](std::istringstream &iss) {
+                        std::string source, name;
+                        if (!(iss >> source >> name)) throw std::runtime_error("Usage: clone <tree> <name>");
+                        handle_clone(source, name);
+                    }
+                },
+                // Save the current version of a persistent tree
+                {"snapshot", [this](std::istringstream &) { handle_snapshot(); }},
+                // Go back to the newest saved version
+                {"rollback", [this](std::istringstream &) { handle_rollback(); }},
+                // Turn the write-ahead log of the current tree on or off
+                {
+                    "wal", [this](std::istringstream &iss) {
+                        std::string mode, policy;
+                        iss >> mode;
+                        if (!(iss >> policy)) policy = "group";
+                        if (mode == "on" && (policy == "group" || policy == "sync")) {
+                            handle_wal_on(policy == "sync" ? SyncPolicy::EveryOp : SyncPolicy::Group);
+                        } else if (mode == "off") {
+                            handle_wal_off();
+                        } else {
+                            throw std::runtime_error("Usage: wal on [group|sync] | wal off");
+                        }
+                    }
+                },
+                // Checkpoint the current tree and truncate its log
+                {"checkpoint", [this](std::istringstream &) { handle_checkpoint(); }},
+                // Set the number of threads used by count/path scans
+                {
+                    "threads", [this](std::istringstream &iss) {
+                        int threads;
+                        if (!(iss >> threads) || threads < 1) throw std::runtime_error("Invalid thread count");
+                        handle_threads(threads);
+                    }
+                },
+                // Snapshot current tree for fast search/count
+                {"freeze", [this](std::istringstream &) { handle_freeze(); }},
+                // Count values smaller than value
+                {
+                    "rank", [this](std::istringstream &iss) {
+                        T value;
+                        if (!(iss >> value)) throw std::runtime_error("Invalid value");
+                        handle_rank(value);
+                    }
+                },
+                // Store a text value under a key (map trees)
+                {
+                    "put", [this](std::istringstream &iss) {
+                        T key;
+                        std::string value;
+                        if (!(iss >> key) || !std::getline(iss >> std::ws, value)) throw std::runtime_error("Usage: put <key> <value>");
+                        handle_put(std::move(key), std::move(value));
+                    }
+                },
+                // Look up the value stored under a key (map trees)
+                {
+                    "get", [this](std::istringstream &iss) {
+                        T key;
+                        if (!(iss >> key)) throw std::runtime_error("Invalid key");
+                        handle_get(key);
+                    }
+                },
+                // List values in [lo, hi]
+                {
+                    "range", [this](std::istringstream &iss) {
+                        T lo, hi;
+                        if (!(iss >> lo >> hi)) throw std::runtime_error("Invalid range");
+                        handle_range(lo, hi);
+                    }
+                },
+                // Count values in [lo, hi]
+                {
+                    "rangecount", [this](std::istringstream &iss) {
+                        T lo, hi;
+                        if (!(iss >> lo >> hi)) throw std::runtime_error("Invalid range");
+                        handle_range_count(lo, hi);
+                    }
+                },
+                // Value at zero-based position in sorted order
+                {
+                    "select", [this](std::istringstream &iss) {
+                        int k;
+                        if (!(iss >> k)) throw std::runtime_error("Invalid index");
+                        handle_select(k);
+                    }
+                },
+                // Median value
+                {"median", [this](std::istringstream &) { handle_percentile(50.0, "Median"); }},
+                // Value at given percentile (nearest rank)
+                {
+                    "percentile", [this](std::istringstream &iss) {
+                        double p;
+                        if (!(iss >> p) || p < 0.0 || p > 100.0) throw std::runtime_error("Percentile must be in [0, 100]");
+                        std::ostringstream label;
+                        label << "Percentile " << p;
+                        handle_percentile(p, label.str());
+                    }
+                },
                 // Print tree structure
                 {"print", [this](std::istringstream &) { handle_print(); }},
                 // Print levels of subtree
@@ -293,6 +1016,17 @@ namespace BinaryTreePlayground {
                 {"treehistory", [this](std::istringstream &) { handle_tree_history(); }},
                 // Toggle colored output
                 {"colors", [this](std::istringstream &) { handle_colors(); }},
+                // Command latency and tree counters: profile [on|off|reset|<command>]
+                {
+                    "profile", [this](std::istringstream &iss) {
+                        std::string option;
+                        iss >> option;
+                        if (option.empty()) handle_profile_report();
+                        else if (option == "on" || option == "off") handle_profile(option == "on");
+                        else if (option == "reset") handle_profile_reset();
+                        else handle_profile_histogram(option);
+                    }
+                },
                 // Show help information
                 {"help", [this](std::istringstream &) { handle_help(); }},
                 // Show help information (alias)
@@ -307,6 +1041,37 @@ namespace BinaryTreePlayground {
             return it->second.get();
         }
 
+        // Batch fast path for the high-volume commands: arguments are parsed straight from the
+        // tokens. Returns false to let the stream-based handler deal with anything else,
+        // including malformed arguments, so errors read the same in both modes.
+        bool run_fast(const std::vector<std::string_view>& tokens) {
+            const std::string_view action = tokens.front();
+            T value;
+            if (action == "insert" || action == "+") {
+                if (tokens.size() < 3 || (tokens[2] != "0" && tokens[2] != "1")) return false;
+                if (!parse_token(tokens[1], value)) return false;
+                bool repeat = tokens[2] == "1";
+                handle_insert(std::move(value), repeat);
+                return true;
+            }
+            if (action == "search" || action == "count") {
+                if (tokens.size() < 2) return false;
+                const auto lookup = [&](const lookup_key_t<T> key) {
+                    if (action == "search") handle_search(key);
+                    else handle_count(key);
+                };
+                // String trees compare against the token in place
+                if constexpr (std::is_same_v<lookup_key_t<T>, std::string_view>) {
+                    lookup(tokens[1]);
+                } else {
+                    if (!parse_token(tokens[1], value)) return false;
+                    lookup(value);
+                }
+                return true;
+            }
+            return false;
+        }
+
         // Generate unique tree name when not provided by user
         std::string generate_tree_name() {
             return "tree_" + std::to_string(++tree_counter_);
@@ -327,7 +1092,8 @@ namespace BinaryTreePlayground {
         }
 
         // Handle tree creation
-        void handle_create(const std::string &name) {
+        void handle_create(const std::string &name, const BalanceMode balance, const DuplicateMode duplicates,
+                           const Backend backend) {
             std::string actual_name = name.empty() ? generate_tree_name() : name;
 
             if (trees_.count(actual_name)) {
@@ -335,9 +1101,19 @@ namespace BinaryTreePlayground {
                 return;
             }
 
-            trees_[actual_name] = std::make_unique<TreeWrapper<T>>(actual_name);
+            trees_[actual_name] = std::make_unique<TreeWrapper<T>>(actual_name, balance, duplicates, backend);
             current_tree_ = actual_name;
-            println_colored("✓ Created tree: '" + actual_name + "'", Colors::GREEN);
+            std::string modes;
+            if (backend == Backend::BTree) modes += " B-tree";
+            else {
+                if (backend == Backend::Map) modes += " map";
+                else if (backend == Backend::Persistent) modes += " persistent";
+                if (balance == BalanceMode::AVL) modes += " AVL";
+                if (duplicates == DuplicateMode::Counted) modes += " counted";
+            }
+            if (quiet_) return;
+            println_colored("✓ Created tree: '" + actual_name + "'" +
+                            (modes.empty() ? "" : " (" + modes.substr(1) + ")"), Colors::GREEN);
             println_colored("Now using: " + actual_name, Colors::CYAN);
         }
 
@@ -345,21 +1121,36 @@ namespace BinaryTreePlayground {
         void handle_use(const std::string &name) {
             if (trees_.count(name)) {
                 current_tree_ = name;
-                println_colored("✓ Now using: " + name, Colors::GREEN);
+                if (!quiet_) println_colored("✓ Now using: " + name, Colors::GREEN);
             } else {
                 println_colored("Error: Tree '" + name + "' not found!", Colors::RED);
             }
         }
 
         // Handle value insertion
-        void handle_insert(const T &value, bool& repeat) {
+        void handle_insert(T value, bool& repeat) {
+            auto tree = get_current_tree();
+            if (quiet_) {
+                tree->insert(std::move(value), repeat);
+                return;
+            }
+            const std::string shown = value_to_string(value);
+            tree->insert(std::move(value), repeat);
+            println_colored("✓ Inserted: " + shown, Colors::GREEN);
+        }
+
+        // Handle bulk insertion
+        void handle_insert_many(std::vector<T> values, const bool repeat) {
             auto tree = get_current_tree();
-            tree->insert(value, repeat);
-            println_colored("✓ Inserted: " + value_to_string(value), Colors::GREEN);
+            const std::size_t count = values.size();
+            tree->insert_many(std::move(values), repeat);
+            const bool rebuilt = tree->get_backend() == Backend::Binary;
+            if (!quiet_) println_colored("✓ Inserted " + std::to_string(count) + " value(s)" +
+                            (rebuilt ? ", tree rebuilt balanced" : ""), Colors::GREEN);
         }
 
         // Handle value search
-        void handle_search(const T &value) {
+        void handle_search(lookup_key_t<T> value) {
             auto tree = get_current_tree();
             bool found = tree->search(value);
             std::string result = "Value '" + value_to_string(value) + "' was " +
@@ -367,6 +1158,18 @@ namespace BinaryTreePlayground {
             println_colored(result, found ? Colors::GREEN : Colors::YELLOW);
         }
 
+        // Handle erase/eraseall
+        void handle_erase(const T& value, const bool all) {
+            auto tree = get_current_tree();
+            const int removed = tree->erase(value, all);
+            if (removed == 0) {
+                println_colored("Value '" + value_to_string(value) + "' is not in the tree", Colors::YELLOW);
+            } else if (!quiet_) {
+                println_colored("✓ Erased: " + value_to_string(value) + (all ? " (" + std::to_string(removed) + " copies)" : ""),
+                                Colors::GREEN);
+            }
+        }
+
         // Handle inorder traversal
         void handle_inorder() {
             auto tree = get_current_tree();
@@ -391,23 +1194,151 @@ namespace BinaryTreePlayground {
             }
         }
 
+        // Handle postorder traversal
+        void handle_postorder() {
+            auto tree = get_current_tree();
+            println_colored("Postorder traversal:", Colors::CYAN);
+            std::string result = tree->postorder();
+            if (result.empty()) {
+                println_colored("(empty)", Colors::YELLOW);
+            } else {
+                std::cout << result;
+            }
+        }
+
         // Handle value counting
-        void handle_count(const T &value) {
+        void handle_count(lookup_key_t<T> value) {
             auto tree = get_current_tree();
-            const int count = tree->count_entries(value);
+            const int count = tree->count_entries(value, pool_.get());
             const std::string message = "Value '" + value_to_string(value) + "' appears " +
                            std::to_string(count) + " time(s) in the tree";
             println_colored(message, Colors::CYAN);
         }
 
         // Handle path display
-        void handle_path(const T &value) {
+        void handle_path(lookup_key_t<T> value) {
             auto tree = get_current_tree();
             println_colored("Path to '" + value_to_string(value) + "': ", Colors::CYAN);
-            const std::string result = tree->get_path(value);
+            const std::string result = tree->get_path(value, pool_.get());
             std::cout << result;
         }
 
+        // Handle snapshot saving
+        void handle_save(const std::string &path) {
+            auto tree = get_current_tree();
+            tree->save(path);
+            if (!quiet_) println_colored("✓ Saved '" + tree->get_name() + "' to " + path, Colors::GREEN);
+        }
+
+        // Handle snapshot loading; the tree keeps the shape and modes it was saved with
+        void handle_load(const std::string &path, const std::string &name) {
+            if (trees_.count(name)) throw std::runtime_error("Tree '" + name + "' already exists!");
+            BinaryTree<T> loaded = load_snapshot<T>(path);
+            const int size = loaded.size();
+            trees_[name] = std::make_unique<TreeWrapper<T>>(name, std::move(loaded));
+            trees_[name]->add_to_history("load " + path);
+            current_tree_ = name;
+            if (!quiet_) println_colored("✓ Loaded " + std::to_string(size) + " value(s) into '" + name + "'", Colors::GREEN);
+        }
+
+        // Handle merge/union/intersect/diff: `<command> <a> <b> [to]`. Both trees are walked in
+        // order once and the result is built balanced with the modes of a. It is stored in the
+        // tree named by the third argument (a new name, a or b), or replaces a without one.
+        void handle_combine(const std::string &command, const SetOperation operation, std::istringstream &iss) {
+            std::string a, b, dest;
+            if (!(iss >> a >> b)) throw std::runtime_error("Usage: " + command + " <a> <b> [to]");
+            if (!(iss >> dest)) dest = a;
+            for (const std::string* name : {&a, &b}) {
+                if (!trees_.count(*name)) throw std::runtime_error("Tree '" + *name + "' not found!");
+            }
+            if (dest != a && dest != b && trees_.count(dest)) throw std::runtime_error("Tree '" + dest + "' already exists!");
+
+            BinaryTree<T> result = trees_[a]->combined(*trees_[b], operation, command);
+            const int size = result.size();
+            const std::string operation_text = command + " " + a + " " + b;
+            if (trees_.count(dest)) {
+                trees_[dest]->assign(std::move(result), operation_text);
+            } else {
+                trees_[dest] = std::make_unique<TreeWrapper<T>>(dest, std::move(result));
+                trees_[dest]->add_to_history(operation_text);
+            }
+            current_tree_ = dest;
+            if (!quiet_) {
+                println_colored("✓ " + command + " of '" + a + "' and '" + b + "' stored in '" + dest + "' (" +
+                                std::to_string(size) + " value(s))", Colors::GREEN);
+            }
+        }
+
+        // Handle clone: the copy becomes the current tree
+        void handle_clone(const std::string &source, const std::string &name) {
+            if (!trees_.count(source)) throw std::runtime_error("Tree '" + source + "' not found!");
+            if (trees_.count(name)) throw std::runtime_error("Tree '" + name + "' already exists!");
+            trees_[name] = trees_[source]->clone(name);
+            current_tree_ = name;
+            if (!quiet_) {
+                println_colored("✓ Cloned '" + source + "' into '" + name + "'", Colors::GREEN);
+                println_colored("Now using: " + name, Colors::CYAN);
+            }
+        }
+
+        // Handle snapshot of the current tree
+        void handle_snapshot() {
+            auto tree = get_current_tree();
+            const std::size_t count = tree->snapshot();
+            if (!quiet_) println_colored("✓ Snapshot " + std::to_string(count) + " of '" + tree->get_name() + "' saved", Colors::GREEN);
+        }
+
+        // Handle rollback to the newest snapshot
+        void handle_rollback() {
+            auto tree = get_current_tree();
+            tree->rollback();
+            if (!quiet_) {
+                println_colored("✓ Rolled '" + tree->get_name() + "' back (" + std::to_string(tree->snapshot_count()) +
+                                " snapshot(s) left)", Colors::GREEN);
+            }
+        }
+
+        // Handle enabling the write-ahead log; the tree is checkpointed first
+        void handle_wal_on(const SyncPolicy policy) {
+            if (journal_dir_.empty()) throw std::runtime_error("Start the playground with --wal-dir <dir> to enable logging");
+            auto tree = get_current_tree();
+            if (!TreeJournal<T>::valid_name(tree->get_name())) {
+                throw std::runtime_error("Tree '" + tree->get_name() + "' cannot be logged: names of logged trees may only "
+                                         "contain letters, digits, '_' and '-'");
+            }
+            tree->enable_journal((std::filesystem::path(journal_dir_) / tree->get_name()).string(), policy);
+            if (!quiet_) {
+                println_colored(std::string("✓ Logging '") + tree->get_name() + "' with " +
+                                (policy == SyncPolicy::EveryOp ? "fsync per operation" : "group commit"), Colors::GREEN);
+            }
+        }
+
+        // Handle disabling the write-ahead log
+        void handle_wal_off() {
+            auto tree = get_current_tree();
+            tree->disable_journal();
+            if (!quiet_) println_colored("✓ Logging disabled for '" + tree->get_name() + "'", Colors::GREEN);
+        }
+
+        // Handle checkpoint request
+        void handle_checkpoint() {
+            auto tree = get_current_tree();
+            tree->checkpoint();
+            if (!quiet_) println_colored("✓ Checkpointed '" + tree->get_name() + "'", Colors::GREEN);
+        }
+
+        // End the current commit group of every logged tree
+        void commit_journals() {
+            for (const auto &[name, tree]: trees_) tree->commit_journal();
+        }
+
+        // Handle thread count change; the command thread joins in, so n threads is n - 1 workers
+        void handle_threads(const int threads) {
+            pool_.reset();
+            if (threads > 1) pool_ = std::make_unique<WorkStealingPool>(static_cast<std::size_t>(threads - 1));
+            if (!quiet_) println_colored("count/path scans now use " + std::to_string(threads) + " thread(s)", Colors::GREEN);
+        }
+
         // Handle tree printing
         void handle_print() {
             auto tree = get_current_tree();
@@ -422,7 +1353,6 @@ namespace BinaryTreePlayground {
         // Handle level display
         void handle_get_level() {
             auto tree = get_current_tree();
-            tree->find_level();
             if (const std::string result = tree->find_level(); result.empty()) {
                 println_colored("(empty)", Colors::YELLOW);
             } else {
@@ -430,11 +1360,80 @@ namespace BinaryTreePlayground {
             }
         }
 
+        // Handle rank query
+        void handle_rank(lookup_key_t<T> value) {
+            auto tree = get_current_tree();
+            const int rank = tree->rank(value);
+            println_colored(std::to_string(rank) + " value(s) are less than '" + value_to_string(value) + "'", Colors::CYAN);
+        }
+
+        // Handle storing a value in a map tree
+        void handle_put(T key, std::string value) {
+            auto tree = get_current_tree();
+            const std::string shown = quiet_ ? std::string() : value_to_string(key);
+            const bool added = tree->put(std::move(key), std::move(value));
+            if (!quiet_) println_colored(std::string(added ? "✓ Added: " : "✓ Updated: ") + shown, Colors::GREEN);
+        }
+
+        // Handle map lookup
+        void handle_get(lookup_key_t<T> key) {
+            auto tree = get_current_tree();
+            if (const std::string* value = tree->get(key)) {
+                println_colored(value_to_string(key) + " = " + *value, Colors::CYAN);
+            } else {
+                println_colored("Key '" + value_to_string(key) + "' not found", Colors::YELLOW);
+            }
+        }
+
+        // Handle range listing
+        void handle_range(lookup_key_t<T> lo, lookup_key_t<T> hi) {
+            auto tree = get_current_tree();
+            const std::string result = tree->range(lo, hi);
+            println_colored("Values in [" + value_to_string(lo) + ", " + value_to_string(hi) + "]:", Colors::CYAN);
+            if (result.empty()) {
+                println_colored("(none)", Colors::YELLOW);
+            } else {
+                std::cout << result;
+            }
+        }
+
+        // Handle range count
+        void handle_range_count(lookup_key_t<T> lo, lookup_key_t<T> hi) {
+            auto tree = get_current_tree();
+            const int count = tree->count_range(lo, hi);
+            println_colored(std::to_string(count) + " value(s) in [" + value_to_string(lo) + ", " +
+                            value_to_string(hi) + "]", Colors::CYAN);
+        }
+
+        // Handle order statistic query
+        void handle_select(const int k) {
+            auto tree = get_current_tree();
+            const T value = tree->select(k);
+            println_colored("Value at position " + std::to_string(k) + ": " + value_to_string(value), Colors::CYAN);
+        }
+
+        // Handle median/percentile query using the nearest-rank method
+        void handle_percentile(const double p, const std::string &label) {
+            auto tree = get_current_tree();
+            const int n = tree->size();
+            if (n == 0) throw std::runtime_error("Tree is empty");
+            const int k = std::max(0, static_cast<int>(std::ceil(p / 100.0 * n)) - 1);
+            const T value = tree->select(k);
+            println_colored(label + ": " + value_to_string(value), Colors::CYAN);
+        }
+
+        // Handle snapshot creation
+        void handle_freeze() {
+            auto tree = get_current_tree();
+            tree->freeze();
+            if (!quiet_) println_colored("✓ Frozen: search/count use the snapshot until the next change", Colors::GREEN);
+        }
+
         // Handle tree clearing
         void handle_clear() {
             auto tree = get_current_tree();
             tree->clear();
-            println_colored("✓ Tree cleared", Colors::GREEN);
+            if (!quiet_) println_colored("✓ Tree cleared", Colors::GREEN);
         }
 
         // Handle tree size query
@@ -454,6 +1453,16 @@ namespace BinaryTreePlayground {
             for (const auto &[name, tree]: trees_) {
                 std::string marker = (name == current_tree_) ? " → " : "   ";
                 std::string status = tree->empty() ? "empty" : "non-empty";
+                if (tree->get_backend() == Backend::BTree) status += ", btree";
+                else {
+                    if (tree->get_backend() == Backend::Map) status += ", map";
+                    else if (tree->get_backend() == Backend::Persistent) status += ", persistent";
+                    if (tree->get_balance() == BalanceMode::AVL) status += ", avl";
+                    if (tree->get_duplicates() == DuplicateMode::Counted) status += ", counted";
+                }
+                if (tree->frozen()) status += ", frozen";
+                if (tree->journaled()) status += ", logged";
+                if (tree->snapshot_count() > 0) status += ", " + std::to_string(tree->snapshot_count()) + " snapshot(s)";
                 std::string color = (name == current_tree_) ? Colors::GREEN : Colors::RESET;
 
                 print_colored(marker + name, color);
@@ -472,7 +1481,7 @@ namespace BinaryTreePlayground {
         // Handle statistics display
         void handle_stats() {
             auto tree = get_current_tree();
-            tree->print_stats();
+            tree->print_stats(show_colors_);
         }
 
         // Handle command history display
@@ -491,7 +1500,7 @@ namespace BinaryTreePlayground {
         // Handle tree operation history display
         void handle_tree_history() {
             auto tree = get_current_tree();
-            const auto& history = tree->get_history();
+            const auto history = tree->get_history();
 
             if (history.empty()) {
                 println_colored("No operations performed on this tree!", Colors::YELLOW);
@@ -511,14 +1520,90 @@ namespace BinaryTreePlayground {
             println_colored("Colors " + status, Colors::GREEN);
         }
 
+        // Handle profiling switch
+        void handle_profile(const bool on) {
+            profiler_.enable(on);
+            if (!quiet_) println_colored(on ? "✓ Profiling on" : "✓ Profiling off", Colors::GREEN);
+        }
+
+        void handle_profile_reset() {
+            profiler_.reset();
+            if (!quiet_) println_colored("✓ Profile cleared", Colors::GREEN);
+        }
+
+        // Handle profile summary: one line per command, most total time first
+        void handle_profile_report() {
+            println_colored(std::string("Profile (") + (profiler_.enabled() ? "on" : "off") + "):", Colors::CYAN);
+            if (profiler_.profiles().empty()) {
+                println_colored(profiler_.enabled() ? "(no commands recorded)" : "(no commands recorded; use 'profile on')",
+                                Colors::YELLOW);
+                return;
+            }
+            std::vector<std::pair<std::string, const CommandProfile*>> rows;
+            for (const auto &[command, profile]: profiler_.profiles()) rows.emplace_back(command, &profile);
+            std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) {
+                return a.second->total_ns > b.second->total_ns;
+            });
+            std::cout << (show_colors_ ? Colors::BOLD : "") << std::left << std::setw(14) << "command" << std::right
+                      << std::setw(10) << "calls" << std::setw(11) << "p50" << std::setw(11) << "p99"
+                      << std::setw(11) << "max" << std::setw(11) << "total" << std::setw(12) << "visits/op"
+                      << std::setw(11) << "allocs/op" << (show_colors_ ? Colors::RESET : "") << std::endl;
+            for (const auto &[command, profile]: rows) {
+                const auto calls = static_cast<double>(profile->latency.count());
+                std::cout << std::left << std::setw(14) << command << std::right
+                          << std::setw(10) << profile->latency.count()
+                          << std::setw(11) << format_duration(profile->latency.percentile(50))
+                          << std::setw(11) << format_duration(profile->latency.percentile(99))
+                          << std::setw(11) << format_duration(profile->latency.max())
+                          << std::setw(11) << format_duration(profile->total_ns)
+                          << std::fixed << std::setprecision(1)
+                          << std::setw(12) << static_cast<double>(profile->node_visits) / calls
+                          << std::setprecision(2)
+                          << std::setw(11) << static_cast<double>(profile->allocations) / calls
+                          << std::defaultfloat << std::endl;
+            }
+        }
+
+        // Handle latency histogram of one command, one row per power of two
+        void handle_profile_histogram(const std::string &command) {
+            const auto it = profiler_.profiles().find(command);
+            if (it == profiler_.profiles().end()) {
+                println_colored("Error: No samples for '" + command + "'", Colors::RED);
+                return;
+            }
+            const LatencyHistogram &latency = it->second.latency;
+            constexpr std::size_t octave = LatencyHistogram::buckets_per_octave();
+            std::vector<std::uint64_t> octaves(latency.buckets().size() / octave, 0);
+            for (std::size_t i = 0; i < latency.buckets().size(); ++i) octaves[i / octave] += latency.buckets()[i];
+            const auto first = std::find_if(octaves.begin(), octaves.end(), [](const auto n) { return n != 0; });
+            const auto last = std::find_if(octaves.rbegin(), octaves.rend(), [](const auto n) { return n != 0; }).base();
+            const std::uint64_t peak = *std::max_element(first, last);
+
+            println_colored("Latency of '" + command + "' (" + std::to_string(latency.count()) + " call(s)):", Colors::CYAN);
+            for (auto row = first; row != last; ++row) {
+                const std::size_t index = static_cast<std::size_t>(row - octaves.begin());
+                const std::uint64_t low = index == 0 ? 0 : LatencyHistogram::bucket_limit(index * octave - 1) + 1;
+                const std::uint64_t high = LatencyHistogram::bucket_limit((index + 1) * octave - 1);
+                const auto width = static_cast<std::size_t>((*row * 40 + peak - 1) / peak);
+                std::cout << std::setw(10) << format_duration(low) << " - " << std::left << std::setw(10)
+                          << format_duration(high) << std::right << " |" << std::string(width, '#')
+                          << " " << *row << std::endl;
+            }
+            std::cout << "p50 " << format_duration(latency.percentile(50))
+                      << ", p90 " << format_duration(latency.percentile(90))
+                      << ", p99 " << format_duration(latency.percentile(99))
+                      << ", max " << format_duration(latency.max()) << std::endl;
+        }
+
         // Handle tree removal
         void handle_remove(const std::string &name) {
             if (trees_.count(name)) {
                 if (current_tree_ == name) {
                     current_tree_.clear();
                 }
+                trees_[name]->disable_journal();
                 trees_.erase(name);
-                println_colored("✓ Removed: " + name, Colors::GREEN);
+                if (!quiet_) println_colored("✓ Removed: " + name, Colors::GREEN);
             } else {
                 println_colored("Error: Tree '" + name + "' not found!", Colors::RED);
             }
@@ -526,41 +1611,79 @@ namespace BinaryTreePlayground {
 
         // Handle help display
         void handle_help() {
-            println_colored("\n" + Colors::BOLD + "=== Binary Tree Playground Commands ===" + Colors::RESET, Colors::CYAN);
-            std::cout << Colors::BOLD << "Tree Management:" << Colors::RESET << std::endl;
+            std::cout << std::endl;
+            println_colored("=== Binary Tree Playground Commands ===", Colors::BOLD + Colors::CYAN);
+            println_colored("Tree Management:", Colors::BOLD);
             std::cout << "  create [name]           - Create new tree (auto-name if omitted)" << std::endl;
+            std::cout << "  create <name> avl       - Create self-balancing (AVL) tree" << std::endl;
+            std::cout << "  create <name> counted   - Store duplicates as a per-node count (combine with avl)" << std::endl;
+            std::cout << "  create <name> btree     - Use the wide-node B-tree backend (no path/freeze)" << std::endl;
+            std::cout << "  create <name> map       - Key-value tree with a text value per key (put/get)" << std::endl;
+            std::cout << "  create <name> persistent - Copy-on-write tree with O(1) clone and snapshots" << std::endl;
+            std::cout << "  clone <tree> <name>     - O(1) copy of a persistent tree" << std::endl;
+            std::cout << "  snapshot                - Save the current version of a persistent tree" << std::endl;
+            std::cout << "  rollback                - Return to the newest snapshot and drop it" << std::endl;
             std::cout << "  use <name>              - Switch to tree" << std::endl;
             std::cout << "  remove <name>           - Remove tree" << std::endl;
+            std::cout << "  save <file>             - Write current tree to a binary snapshot" << std::endl;
+            std::cout << "  load <file> [name]      - Load a snapshot into a new tree" << std::endl;
+            std::cout << "  wal on [group|sync]     - Log changes of current tree (needs --wal-dir)" << std::endl;
+            std::cout << "  wal off                 - Stop logging and delete the log" << std::endl;
+            std::cout << "  checkpoint              - Snapshot a logged tree and truncate its log" << std::endl;
             std::cout << "  list                    - List all trees" << std::endl;
+            std::cout << "  merge <a> <b> [to]      - Every value of a and b, built balanced into to (default a)" << std::endl;
+            std::cout << "  union <a> <b> [to]      - Values of a or b (larger count of each), into to" << std::endl;
+            std::cout << "  intersect <a> <b> [to]  - Values of both (smaller count of each), into to" << std::endl;
+            std::cout << "  diff <a> <b> [to]       - Values of a not matched in b, into to" << std::endl;
 
-            std::cout << Colors::BOLD << "\nTree Operations:" << Colors::RESET << std::endl;
+            println_colored("\nTree Operations:", Colors::BOLD);
             std::cout << "  insert <value>          - Insert value into current tree" << std::endl;
+            std::cout << "  insertmany <r> <v>...   - Bulk-insert values and rebuild balanced" << std::endl;
+            std::cout << "  insertfile <file> <r>   - Bulk-insert values read from file" << std::endl;
+            std::cout << "  erase <value>           - Remove one copy of value" << std::endl;
+            std::cout << "  eraseall <value>        - Remove every copy of value" << std::endl;
             std::cout << "  search <value>          - Search for value" << std::endl;
             std::cout << "  count <value>           - Count occurrences of value" << std::endl;
             std::cout << "  path <value>            - Show path to value" << std::endl;
+            std::cout << "  put <key> <value>       - Store value under key (map trees)" << std::endl;
+            std::cout << "  get <key>               - Show the value stored under key (map trees)" << std::endl;
+            std::cout << "  freeze                  - Snapshot tree for fast search/count until next change" << std::endl;
             std::cout << "  clear                   - Clear current tree" << std::endl;
 
-            std::cout << Colors::BOLD << "\nTree Analysis:" << Colors::RESET << std::endl;
+            println_colored("\nTree Analysis:", Colors::BOLD);
             std::cout << "  levels                  - Print min and max levels of subtree" << std::endl;
             std::cout << "  inorder                 - Inorder traversal" << std::endl;
             std::cout << "  preorder                - Preorder traversal" << std::endl;
+            std::cout << "  postorder               - Postorder traversal" << std::endl;
             std::cout << "  print                   - Print tree structure" << std::endl;
             std::cout << "  size                    - Get tree size" << std::endl;
+            std::cout << "  rank <value>            - Count values smaller than value" << std::endl;
+            std::cout << "  select <k>              - Value at zero-based position k in sorted order" << std::endl;
+            std::cout << "  range <lo> <hi>         - List values in [lo, hi] in sorted order" << std::endl;
+            std::cout << "  rangecount <lo> <hi>    - Count values in [lo, hi]" << std::endl;
+            std::cout << "  median                  - Median value" << std::endl;
+            std::cout << "  percentile <p>          - Value at percentile p (0-100)" << std::endl;
             std::cout << "  stats                   - Show tree statistics" << std::endl;
             std::cout << "  empty                   - Check if current tree is empty" << std::endl;
 
-            std::cout << Colors::BOLD << "\nHistory & Settings:" << Colors::RESET << std::endl;
+            println_colored("\nHistory & Settings:", Colors::BOLD);
             std::cout << "  history                 - Show command history" << std::endl;
             std::cout << "  treehistory             - Show tree operation history" << std::endl;
             std::cout << "  colors                  - Toggle color output" << std::endl;
+            std::cout << "  threads <n>             - Threads used by count/path on large trees" << std::endl;
+            std::cout << "  profile on|off|reset    - Time every command and count node visits/allocations" << std::endl;
+            std::cout << "  profile [command]       - Show per-command latency, or one command's histogram" << std::endl;
             std::cout << "  help, ?                 - Show this help" << std::endl;
             std::cout << "  exit, quit              - Exit playground" << std::endl;
 
-            std::cout << Colors::BOLD << "\nExamples:" << Colors::RESET << std::endl;
-            std::cout << "  create mytree           " << Colors::YELLOW << "# Create tree named 'mytree'" << Colors::RESET << std::endl;
-            std::cout << "  insert 50 1             " << Colors::YELLOW << "# Insert value 50 with repeat" << Colors::RESET << std::endl;
-            std::cout << "  stats                   " << Colors::YELLOW << "# Show tree statistics" << Colors::RESET << std::endl;
-            std::cout << Colors::BOLD << "========================================" << Colors::RESET << std::endl;
+            println_colored("\nExamples:", Colors::BOLD);
+            std::cout << "  create mytree           ";
+            println_colored("# Create tree named 'mytree'", Colors::YELLOW);
+            std::cout << "  insert 50 1             ";
+            println_colored("# Insert value 50 with repeat", Colors::YELLOW);
+            std::cout << "  stats                   ";
+            println_colored("# Show tree statistics", Colors::YELLOW);
+            println_colored("========================================", Colors::BOLD);
         }
 
         // Add command to history with size limit
@@ -576,6 +1699,91 @@ namespace BinaryTreePlayground {
             initialize_commands();
         }
 
+        // Quiet output drops prompts, confirmations and colors; errors and results remain
+        void set_quiet(const bool quiet) {
+            quiet_ = quiet;
+            show_colors_ = !quiet;
+        }
+
+        // Recover every tree logged in directory and keep new logs there
+        void open_journal_dir(const std::string& directory) {
+            std::filesystem::create_directories(directory);
+            journal_dir_ = directory;
+            for (const auto &[name, base]: TreeJournal<T>::list(directory)) {
+                try {
+                    auto [tree, journal] = TreeJournal<T>::recover(base);
+                    const int size = tree.size();
+                    trees_[name] = std::make_unique<TreeWrapper<T>>(name, std::move(tree), std::move(journal));
+                    trees_[name]->add_to_history("recovered");
+                    if (!quiet_) println_colored("✓ Recovered '" + name + "' (" + std::to_string(size) + " value(s))", Colors::GREEN);
+                } catch (const std::exception &e) {
+                    println_colored("Error: cannot recover '" + name + "': " + e.what(), Colors::RED);
+                }
+            }
+        }
+
+        // Execute commands from in without prompts, confirmations or history; output is
+        // buffered and a timing summary goes to std::cerr at the end
+        void run_batch(std::istream& in) {
+            set_quiet(true);
+            BatchOutputBuffer buffer(std::cout.rdbuf());
+            struct Restore {
+                std::streambuf* previous;
+                ~Restore() { std::cout.rdbuf(previous); }
+            } restore{std::cout.rdbuf(&buffer)};
+
+            const auto start = std::chrono::steady_clock::now();
+            std::size_t commands = 0, errors = 0, line_number = 0;
+            std::string line;
+            std::vector<std::string_view> tokens;
+            while (std::getline(in, line)) {
+                ++line_number;
+                tokens.clear();
+                const std::string_view view = line;
+                for (std::size_t pos = view.find_first_not_of(" \t\r"); pos != std::string_view::npos; ) {
+                    const std::size_t end = std::min(view.find_first_of(" \t\r", pos), view.size());
+                    tokens.push_back(view.substr(pos, end - pos));
+                    pos = view.find_first_not_of(" \t\r", end);
+                }
+                if (tokens.empty()) continue;
+
+                const std::string_view action = tokens.front();
+                if (action == "exit" || action == "quit") break;
+                ++commands;
+
+                try {
+                    auto scope = profiler_.measure(action);
+                    if (!run_fast(tokens)) {
+                        std::istringstream iss(line);
+                        std::string name;
+                        iss >> name;
+                        if (auto it = commands_.find(name); it != commands_.end()) {
+                            it->second(iss);
+                        } else {
+                            scope.cancel();
+                            ++errors;
+                            println_colored("line " + std::to_string(line_number) + ": Unknown command: '" + name + "'", Colors::RED);
+                        }
+                    }
+                } catch (const std::exception &e) {
+                    ++errors;
+                    println_colored("line " + std::to_string(line_number) + ": Error: " + std::string(e.what()), Colors::RED);
+                } catch (...) {
+                    ++errors;
+                    println_colored("line " + std::to_string(line_number) + ": Unknown error occurred", Colors::RED);
+                }
+            }
+            commit_journals();
+            buffer.flush();
+
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            const double seconds = elapsed.count();
+            std::cerr << "Batch: " << commands << " command(s), " << errors << " error(s) in "
+                      << std::fixed << std::setprecision(3) << seconds << " s ("
+                      << std::setprecision(0) << (seconds > 0 ? static_cast<double>(commands) / seconds : 0.0)
+                      << " ops/sec)" << std::endl;
+        }
+
         // Main interactive loop
         void run() {
             println_colored("\n" + Colors::BOLD + "Binary Tree Playground" + Colors::RESET, Colors::GREEN);
@@ -583,6 +1791,9 @@ namespace BinaryTreePlayground {
 
             std::string command;
             while (true) {
+                // Everything logged so far becomes durable before the user sees the prompt
+                commit_journals();
+
                 // Display prompt with current tree context
                 if (current_tree_.empty()) {
                     print_colored("bt-playground> ", Colors::YELLOW);
@@ -608,6 +1819,7 @@ namespace BinaryTreePlayground {
                 try {
                     // Execute command if found
                     if (auto it = commands_.find(action); it != commands_.end()) {
+                        const auto scope = profiler_.measure(action);
                         it->second(iss);
                     } else {
                         println_colored("Unknown command: '" + action + "'. Type 'help' for available commands.", Colors::RED);
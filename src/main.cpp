@@ -1,73 +1,139 @@
 #include <iostream>
 #include <limits>
 #include <cstdlib>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <string>
 
-#ifndef _WIN32
-#include <windows.h
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
 #endif
 
 #include "../lib/tui/binary_tree_tui.h"
 
-int main() {
-#ifndef _WIN32
-    HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE);
-    DWORD dwMode = 0;
+namespace {
+    // Run the playground for one value type, interactively or over a script
+    template<typename T>
+    void start(std::istream* script, const std::string& wal_dir) {
+        BinaryTreePlayground::BinaryTreePlaygroundManager<T> manager;
+        if (script) manager.set_quiet(true);
+        if (!wal_dir.empty()) manager.open_journal_dir(wal_dir);
+        if (script) manager.run_batch(*script);
+        else manager.run();
+    }
 
-    if (!GetConsoleMode(h, &dwMode)) {
-        throw std::runtime_error("GetConsoleMode failed");
-        return 1;
+    bool stdin_is_terminal() {
+#ifdef _WIN32
+        return _isatty(_fileno(stdin)) != 0;
+#else
+        return isatty(STDIN_FILENO) != 0;
+#endif
     }
+}
 
-    dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+// Usage: LiOAvIZ_Lab4 [--script <file>] [--interactive] [--wal-dir <dir>]
+// Batch mode runs a script file, or stdin when it is not a terminal (--interactive
+// keeps the prompt for piped input). The first line picks the data type (1-4); scripts
+// may omit it to use int. --wal-dir recovers the trees logged in dir and keeps new logs there.
+int main(const int argc, char** argv) {
+    std::string script_path;
+    std::string wal_dir;
+    bool force_interactive = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--script" && i + 1 < argc) {
+            script_path = argv[++i];
+        } else if (arg == "--wal-dir" && i + 1 < argc) {
+            wal_dir = argv[++i];
+        } else if (arg == "--interactive") {
+            force_interactive = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--script <file>] [--interactive] [--wal-dir <dir>]" << std::endl;
+            return 1;
+        }
+    }
 
-    if (!SetConsoleMode(h, dwMode)) {
-        throw std::runtime_error("SetConsoleMode failed");
-        return 1;
+    std::ifstream script_file;
+    std::istream* script = nullptr;
+    if (!script_path.empty()) {
+        script_file.open(script_path);
+        if (!script_file) {
+            std::cerr << "Cannot open script '" << script_path << "'" << std::endl;
+            return 1;
+        }
+        script = &script_file;
+    } else if (!force_interactive && !stdin_is_terminal()) {
+        script = &std::cin;
     }
+
+    std::istream& input = script ? *script : std::cin;
+    char type_choice = '1';
+    if (script) {
+        // The type line is optional in scripts; commands never start with a digit
+        input >> std::ws;
+        if (std::isdigit(input.peek())) {
+            input >> type_choice;
+            input.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        }
+    } else {
+#ifdef _WIN32
+        HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD dwMode = 0;
+
+        if (!GetConsoleMode(h, &dwMode)) {
+            throw std::runtime_error("GetConsoleMode failed");
+            return 1;
+        }
+
+        dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+
+        if (!SetConsoleMode(h, dwMode)) {
+            throw std::runtime_error("SetConsoleMode failed");
+            return 1;
+        }
 #endif
 
-    std::cout << "Binary Tree Playground" << std::endl;
-    std::cout << "============================" << std::endl;
+        std::cout << "Binary Tree Playground" << std::endl;
+        std::cout << "============================" << std::endl;
 
-    std::cout << "Choose data type:" << std::endl;
-    std::cout << "1 - int" << std::endl;
-    std::cout << "2 - double" << std::endl;
-    std::cout << "3 - string" << std::endl;
-    std::cout << "4 - char" << std::endl;
-    std::cout << "Enter choice (1-4): ";
+        std::cout << "Choose data type:" << std::endl;
+        std::cout << "1 - int" << std::endl;
+        std::cout << "2 - double" << std::endl;
+        std::cout << "3 - string" << std::endl;
+        std::cout << "4 - char" << std::endl;
+        std::cout << "Enter choice (1-4): ";
 
-    char type_choice;
-    std::cin >> type_choice;
-    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        std::cin >> type_choice;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
 
     switch (type_choice) {
         case '1': {
-            BinaryTreePlayground::BinaryTreePlaygroundManager<int> manager;
-            manager.run();
+            start<int>(script, wal_dir);
             break;
         }
         case '2': {
-            BinaryTreePlayground::BinaryTreePlaygroundManager<double> manager;
-            manager.run();
+            start<double>(script, wal_dir);
             break;
         }
         case '3': {
-            BinaryTreePlayground::BinaryTreePlaygroundManager<std::string> manager;
-            manager.run();
+            start<std::string>(script, wal_dir);
             break;
         }
         case '4': {
-            BinaryTreePlayground::BinaryTreePlaygroundManager<char> manager;
-            manager.run();
+            start<char>(script, wal_dir);
             break;
         }
         default: {
-            std::cout << "Invalid choice! Using int by default." << std::endl;
-            BinaryTreePlayground::BinaryTreePlaygroundManager<int> manager;
-            manager.run();
+            (script ? std::cerr : std::cout) << "Invalid choice! Using int by default." << std::endl;
+            start<int>(script, wal_dir);
             break;
         }
     }
 
     return 0;
-}
\ No newline at end of file
+}